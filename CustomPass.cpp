@@ -12,35 +12,159 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/Pass.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/Analysis/TypeBasedAliasAnalysis.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/PointerIntPair.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/LinkAllPasses.h"
+#include "Runtime/IDCSlice.h"
+#include "Runtime/IDCInject.h"
 #include <stack>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <chrono>
 
 #define DEBUG_TYPE "dependency-check"
 
+STATISTIC(NumSummaryCacheHits, "Number of function summaries loaded from the cache");
+STATISTIC(NumSummaryCacheMisses, "Number of function summaries computed and stored in the cache");
+STATISTIC(NumIncrementalSummaries, "Number of function summaries reused from the incremental state");
+STATISTIC(NumIncrementalSlices, "Number of functions whose slices were reused from the incremental state");
+STATISTIC(NumInjectionSites, "Number of fault-injection hooks inserted");
+STATISTIC(NumEquivalentSites, "Number of slice sites covered by an equivalent site");
+
+using namespace llvm;
+
 /// Dependency check과정에서 확인된 inst를 콘솔에 
 /// 출력할 지의 여부를 결정합니다.
-#define IDC_PRINT_INSTRUCTION                       0
+static cl::opt<bool> IDCPrintInstruction("idc-print-instruction",
+  cl::desc("Print every instruction visited by the dependency walk"),
+  cl::init(false));
 
 /// Dependency check 결과를 출력할 지의 여부를 결정합니다.
-#define IDC_PRINT_RESULT                            1
+static cl::opt<bool> IDCPrintResult("idc-print-result",
+  cl::desc("Print the slices of each checked function"),
+  cl::init(true));
 
 /// 함수가 정의되지 않은 경우, 콘솔에 메시지를 출력합니다.
-#define IDC_PRINT_MSG_EMPTY_FUNCTION                1
+static cl::opt<bool> IDCPrintEmptyFunction("idc-print-empty-function",
+  cl::desc("Print a message for each called function without a body"),
+  cl::init(true));
 
 /// 함수가 정의되지 않은 경우, 해당 함수의 함수인자가
 /// 리턴값에 영향을 미치는지 여부를 결정합니다.
-#define IDC_EMPTY_FUNCTION_PARAM_AFFECT_RETURN      1
+static cl::opt<bool> IDCEmptyFunctionAffectsReturn("idc-empty-function-affects-return",
+  cl::desc("Assume every argument of a function without a body affects its return value"),
+  cl::init(true));
 
 /// branch map을 이용한 검사를 할 지의 여부를 결정합니다.
-#define IDC_SCAN_CONTROL_FLOW                       1
-
-
-using namespace llvm;
+static cl::opt<bool> IDCScanControlFlow("idc-scan-control-flow",
+  cl::desc("Follow the branches that control the execution of visited instructions"),
+  cl::init(true));
+
+/// Dependency 검사 결과를 표시하는 metadata의 이름입니다.
+/// !idc.dep는 Perpect, !idc.maybe는 Maybe dependency를 뜻합니다.
+static const char *IDCDependencyMD = "idc.dep";
+static const char *IDCMaybeDependencyMD = "idc.maybe";
+
+/// 모듈 단위 분석에서 서로 독립적인 SCC들의 요약정보를 동시에 계산할
+/// 스레드의 수입니다. 1이면 기존처럼 한 스레드에서 계산합니다.
+static cl::opt<unsigned> IDCThreads("idc-threads",
+  cl::desc("Number of threads computing call-graph SCC summaries"),
+  cl::init(1));
+
+/// 함수 요약정보를 저장해 둘 디렉터리입니다. 비어 있으면 사용하지 않습니다.
+/// 모듈 단위 분석(dependency-module)에서만 사용됩니다.
+static cl::opt<std::string> IDCSummaryCache("idc-summary-cache",
+  cl::desc("Directory of the persistent function summary cache"),
+  cl::value_desc("directory"), cl::init(""));
+
+/// 이전 분석 결과를 저장해 두고 다음 분석에서 바뀌지 않은 함수의 요약정보와
+/// slice를 다시 사용할 파일입니다. 모듈 단위 분석에서만 사용됩니다.
+static cl::opt<std::string> IDCIncremental("idc-incremental",
+  cl::desc("Reuse unaffected summaries and slices recorded in a state file"),
+  cl::value_desc("filename"), cl::init(""));
+
+/// 각 대상 함수의 slice를 Runtime/IDCSlice.h 형식으로 내보낼 파일입니다.
+static cl::opt<std::string> IDCSliceOutput("idc-slice-output",
+  cl::desc("Write the computed slices to a binary slice file"),
+  cl::value_desc("filename"), cl::init(""));
+
+/// slice site들을 예상 실행 횟수 순으로 정렬하여 내보낼 파일입니다.
+static cl::opt<std::string> IDCSiteRanking("idc-site-ranking",
+  cl::desc("Write slice sites ranked by their estimated execution count"),
+  cl::value_desc("filename"), cl::init(""));
+
+/// 한 함수 안의 annotated variable들에 대한 slice를 동시에 만들 스레드의 수입니다.
+static cl::opt<unsigned> IDCSliceThreads("idc-slice-threads",
+  cl::desc("Number of threads slicing annotated variables of one function"),
+  cl::init(1));
+
+/// IDCAnalysis가 slice를 미리 계산하지 않고, isInSlice 질문에 필요한 만큼만
+/// 탐색하게 합니다.
+static cl::opt<bool> IDCLazySlices("idc-lazy-slices",
+  cl::desc("Answer slice membership queries on demand instead of slicing eagerly"),
+  cl::init(false));
+
+/// fault-injection hook(dependency-inject, idc-inject)을 Perpect뿐 아니라
+/// Maybe인 Instruction에도 넣습니다.
+static cl::opt<bool> IDCInjectMaybe("idc-inject-maybe",
+  cl::desc("Also instrument Maybe dependencies for fault injection"),
+  cl::init(false));
+
+/// LoadInst가 읽는 값을 쓴 StoreInst를 MemorySSA와 alias analysis로 찾습니다.
+/// 끄면 포인터가 같은 StoreInst만 찾습니다.
+static cl::opt<bool> IDCMemorySSA("idc-memssa",
+  cl::desc("Find reaching stores of loads with MemorySSA and alias analysis"),
+  cl::init(false));
+
+/// 요약정보를 모두 계산한 뒤 DependencyMap::getDependency를 모듈의 함수
+/// 수 × 이 값만큼 호출하여 초당 조회 횟수를 출력합니다. (idc-pass-bench)
+static cl::opt<unsigned> IDCLookupBenchmark("idc-lookup-benchmark",
+  cl::desc("Time this many rounds of summary lookups over all functions"),
+  cl::Hidden, cl::init(0));
 
 /*
   Same name function have same algorithm.
@@ -52,143 +176,386 @@ namespace {
   
   ///---------------------------------------------------------
   ///
-  ///          Branch Map
+  ///          Control Dependence
   ///
   ///---------------------------------------------------------
 
-  class BlockNode
+  /// [정보]
+  /// 함수의 PostDominatorTree로부터 각 블록이 control dependent한 블록들을
+  /// 함수마다 한 번만 계산해 둡니다. 블록 B가 블록 A에 control dependent하다는
+  /// 것은 A의 분기 결과에 따라 B의 실행 여부가 결정된다는 뜻입니다.
+  ///
+  /// [보충]
+  /// - post-dominance frontier를 구하는 방법(Ferrante et al.)을 사용합니다.
+  ///   A → S 간선에서 S가 A를 post-dominate하지 않으면, S부터 A의 immediate
+  ///   post-dominator 직전까지 PostDominatorTree를 거슬러 오르는 블록들이
+  ///   모두 A에 control dependent합니다.
+  /// - 조건을 가진 BranchInst와 SwitchInst만 분기로 취급합니다.
+  /// - getControllingBlocks는 O(1)에 결과를 돌려줍니다. 전이적인 control
+  ///   dependence는 탐색하는 쪽에서 따라갑니다.
+  /// - -idc-scan-control-flow가 꺼져 있으면 계산하지 않습니다.
+  class ControlDependence
   {
-    BasicBlock *basic_block;
-    BranchInst *branch_inst;
-    SmallVector<BlockNode *, 4> from_node;
-    SmallVector<BlockNode *, 4> to_node;
+    using BlockList = SmallVector<BasicBlock *, 2>;
+    DenseMap<const BasicBlock *, BlockList> controlling_blocks;
 
   public:
 
-    BlockNode(BasicBlock *BB) : basic_block(BB), branch_inst(nullptr) { }
-    
-    void addFromNode(BlockNode *BN) { from_node.push_back(BN); }
-    SmallVector<BlockNode *, 4>& getFromNodes() { return from_node; }
-    void addToNode(BlockNode *BN) { to_node.push_back(BN); }
-    SmallVector<BlockNode *, 4>& getToNodes() { return to_node; }
+    ControlDependence(Function *F)
+    {
+      if (!IDCScanControlFlow || F->isIntrinsic() || F->empty())
+        return;
+
+      PostDominatorTree pdt(*F);
+      for (BasicBlock& basic_block : *F)
+      {
+        if (!getCondition(&basic_block))
+          continue;
+        DomTreeNode *node = pdt.getNode(&basic_block);
+        if (!node)
+          continue;
+        DomTreeNode *ipdom = node->getIDom();
+
+        for (BasicBlock *succ : successors(&basic_block))
+        {
+          for (DomTreeNode *runner = pdt.getNode(succ);
+               runner && runner != ipdom; runner = runner->getIDom())
+          {
+            BasicBlock *BB = runner->getBlock();
+            if (!BB)
+              break;
+            BlockList& list = controlling_blocks[BB];
+            if (!is_contained(list, &basic_block))
+              list.push_back(&basic_block);
+          }
+        }
+      }
+    }
 
-    void setBranchInst(BranchInst *BI) { branch_inst = BI; }
-    BranchInst *getBranchInst() { return branch_inst; }
+    /// BB의 실행 여부를 직접 결정하는 분기 블록들입니다.
+    ArrayRef<BasicBlock *> getControllingBlocks(const BasicBlock *BB) const
+    {
+      auto it = controlling_blocks.find(BB);
+      if (it == controlling_blocks.end())
+        return None;
+      return it->second;
+    }
 
-    BasicBlock *getBasicBlock() { return basic_block; }
+    /// 분기 블록의 조건값입니다. 분기가 아니라면 nullptr을 반환합니다.
+    static Value *getCondition(BasicBlock *BB)
+    {
+      Instruction *term = BB->getTerminator();
+      if (!term)
+        return nullptr;
+      if (BranchInst *bi = dyn_cast<BranchInst> (term))
+        return bi->isConditional() ? bi->getCondition() : nullptr;
+      if (SwitchInst *si = dyn_cast<SwitchInst> (term))
+        return si->getCondition();
+      return nullptr;
+    }
   };
 
-  class BranchManager
+  ///---------------------------------------------------------
+  ///
+  ///                    Pass Tools
+  ///
+  ///---------------------------------------------------------
+
+  /// 함수 내부의 모든 Instruction에 0부터 시작하는 고유번호를 부여합니다.
+  /// InstructionDependency는 이 번호를 BitVector의 색인으로 사용합니다.
+  class InstructionNumbering
   {
-    Function *function;
-    BlockNode *start;
-    std::vector<BlockNode *> nodes;
+    DenseMap<const Instruction *, unsigned> number_map;
+    std::vector<Instruction *> insts;
 
   public:
 
-    BranchManager(Function *F) : function(F) 
+    InstructionNumbering(Function *F)
     {
-      if (!F->isIntrinsic()) 
-      {
-        start = new BlockNode(&F->getEntryBlock());
-        nodes.push_back(start);
-        if (BranchInst *bi = dyn_cast<BranchInst> (&start->getBasicBlock()->back())) {
-          start->setBranchInst(bi);
-          for (size_t i = 0; i < bi->getNumSuccessors(); i++)
-            start->addToNode(run(bi->getSuccessor(i), start));
+      for (BasicBlock& basic_block : *F)
+        for (Instruction& inst : basic_block) {
+          number_map[&inst] = insts.size();
+          insts.push_back(&inst);
         }
-      }
     }
 
-    BlockNode *getNodeFromInstruction(Instruction *inst)
+    unsigned getNumber(const Instruction *I) const
     {
-      for (BlockNode *bn : nodes)
-        for (Instruction& i : *bn->getBasicBlock())
-          if (&i == inst)
-            return bn;
-      return nullptr;
+      auto it = number_map.find(I);
+      assert(it != number_map.end() && "Instruction is not in this function!");
+      return it->second;
+    }
+    Instruction *getInstruction(unsigned N) const { return insts[N]; }
+    size_t size() const { return insts.size(); }
+  };
+
+  /// [정보]
+  /// 어떤 Value를 포인터나 값으로 사용하는 StoreInst, LoadInst와 그 Value를
+  /// 함수인자로 넘기는 CallInst의 목록을 함수마다 한 번만 만들어 둡니다.
+  ///
+  /// [보충]
+  /// - runSearch 계열 함수들은 매번 함수 전체를 훑는 대신 이 색인에서
+  ///   V와 관련된 Instruction만 확인합니다.
+  /// - 각 목록은 함수 내부의 Instruction 순서를 유지합니다.
+  class ValueAccessIndex
+  {
+    using AccessList = SmallVector<Instruction *, 4>;
+    DenseMap<const Value *, AccessList> access_map;
+
+    void addAccess(const Value *V, Instruction *I)
+    {
+      AccessList& list = access_map[V];
+      if (list.empty() || list.back() != I)
+        list.push_back(I);
+    }
+
+  public:
+
+    ValueAccessIndex(Function *F)
+    {
+      for (BasicBlock& basic_block : *F)
+        for (Instruction& inst : basic_block) {
+          if (StoreInst *si = dyn_cast<StoreInst> (&inst)) {
+            addAccess(si->getPointerOperand(), si);
+            addAccess(si->getValueOperand(), si);
+          } else if (LoadInst *li = dyn_cast<LoadInst> (&inst)) {
+            addAccess(li->getPointerOperand(), li);
+          } else if (CallInst *ci = dyn_cast<CallInst> (&inst)) {
+            for (Value *arg : ci->args())
+              addAccess(arg, ci);
+          }
+        }
+    }
+
+    ArrayRef<Instruction *> getAccesses(const Value *V) const
+    {
+      auto it = access_map.find(V);
+      if (it == access_map.end())
+        return None;
+      return it->second;
+    }
+  };
+
+  /// [정보]
+  /// -idc-memssa가 켜져 있을 때, 함수의 각 LoadInst가 읽을 수 있는 값을 쓴
+  /// Instruction(reaching definition)들을 MemorySSA로 미리 찾아 둡니다.
+  ///
+  /// [보충]
+  /// - GEP나 bitcast를 거친 포인터로 쓴 StoreInst도 alias analysis(BasicAA,
+  ///   TBAA)로 찾을 수 있습니다.
+  /// - MemoryPhi를 만나면 각 incoming 값에서 다시 clobber를 찾습니다.
+  ///   liveOnEntry에 도달한 경로는 함수 밖에서 들어온 값이므로 무시합니다.
+  /// - lifetime.start/end에 도달한 경로도 무시합니다.
+  /// - 결과를 함수마다 한 번에 계산해 두므로, 여러 SliceWalker가 동시에
+  ///   읽어도 안전합니다. MemorySSA는 계산이 끝나면 버립니다.
+  /// - 각 reaching definition에는 LoadInst와 MustAlias인 StoreInst인지가
+  ///   함께 기록됩니다.
+  class MemoryDependence
+  {
+  public:
+    using Definition = PointerIntPair<Instruction *, 1, bool>;
+
+  private:
+    DenseMap<const LoadInst *, SmallVector<Definition, 2>> definitions;
+
+  public:
+
+    MemoryDependence(Function *F)
+    {
+      const DataLayout& DL = F->getParent()->getDataLayout();
+      TargetLibraryInfoImpl tlii(Triple(F->getParent()->getTargetTriple()));
+      TargetLibraryInfo tli(tlii, F);
+      AssumptionCache ac(*F);
+      DominatorTree dt(*F);
+      BasicAAResult basic_aa(DL, *F, tli, ac, &dt);
+      TypeBasedAAResult tbaa;
+      AAResults aa(tli);
+      aa.addAAResult(basic_aa);
+      aa.addAAResult(tbaa);
+      MemorySSA mssa(*F, &aa, &dt);
+      MemorySSAWalker *walker = mssa.getWalker();
+
+      for (BasicBlock& basic_block : *F)
+        for (Instruction& inst : basic_block)
+          if (LoadInst *li = dyn_cast<LoadInst> (&inst))
+            addDefinitions(li, mssa, walker, aa);
+    }
+
+    /// LI의 reaching definition들입니다.
+    ArrayRef<Definition> getDefinitions(const LoadInst *LI) const
+    {
+      auto it = definitions.find(LI);
+      if (it == definitions.end())
+        return None;
+      return it->second;
     }
 
   private:
 
-    BlockNode *run(BasicBlock *BB, BlockNode *P)
+    void addDefinitions(LoadInst *LI, MemorySSA& MSSA, MemorySSAWalker *Walker, AAResults& AA)
     {
-      BlockNode *node = new BlockNode(BB);
-      node->addFromNode(P);
-      nodes.push_back(node);
-      Instruction *last = &BB->back();
-      if (BranchInst *bi = dyn_cast<BranchInst> (last))
+      MemoryLocation location = MemoryLocation::get(LI);
+      SmallVector<MemoryAccess *, 8> worklist;
+      SmallPtrSet<MemoryAccess *, 8> visited;
+      SmallVector<Definition, 2>& list = definitions[LI];
+
+      worklist.push_back(Walker->getClobberingMemoryAccess(LI));
+      while (!worklist.empty())
       {
-        node->setBranchInst(bi);
-        for (size_t i = 0; i < bi->getNumSuccessors(); i++)
-        {
-          for (size_t j = 0; j < nodes.size(); j++)
-            if (nodes[j]->getBasicBlock() == bi->getSuccessor(i))
-            {
-              node->addToNode(nodes[j]);
-              nodes[j]->addFromNode(node);
-              goto FINISH;
-            }
-          node->addToNode(run(bi->getSuccessor(i), node));
-        FINISH:
-          ;
+        MemoryAccess *access = worklist.pop_back_val();
+        if (!access || MSSA.isLiveOnEntryDef(access) || !visited.insert(access).second)
+          continue;
+
+        if (MemoryPhi *phi = dyn_cast<MemoryPhi> (access)) {
+          for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+            worklist.push_back(Walker->getClobberingMemoryAccess(phi->getIncomingValue(i), location));
+          continue;
         }
+
+        // lifetime.start/end는 값을 쓰지 않으므로 definition이 아닙니다.
+        Instruction *def = cast<MemoryDef> (access)->getMemoryInst();
+        if (def->isLifetimeStartOrEnd())
+          continue;
+        bool must = false;
+        if (StoreInst *si = dyn_cast<StoreInst> (def))
+          must = AA.alias(MemoryLocation::get(si), location) == AliasResult::MustAlias;
+        list.push_back(Definition(def, must));
       }
-      return node;
     }
-
   };
 
-  ///---------------------------------------------------------
-  ///
-  ///                    Pass Tools
+  /// [정보]
+  /// Dependency를 가지는 Instruction들의 집합입니다.
   ///
-  ///---------------------------------------------------------
-
+  /// [보충]
+  /// - 포함 여부와 Perpect/Maybe 여부는 InstructionNumbering의 번호를 색인으로
+  ///   하는 BitVector들로 관리되므로 검사와 갱신이 O(1)입니다.
+  /// - 두 집합의 합집합(merge)은 word 단위 OR로 계산됩니다.
+  /// - 순회는 Instruction이 추가된 순서를 따릅니다. (DependencyPrinter)
+  ///   merge로 한 번에 추가된 Instruction들은 함수 내부의 순서로 추가됩니다.
   class InstructionDependency
   {
     using PairType = std::pair<Instruction *, bool>;
-    using InstsType = std::vector<PairType>;
-    InstsType insts;
+
+    const InstructionNumbering *numbering;
+    BitVector perfect;
+    BitVector maybe;
+    BitVector members;
+    /// members에 추가된 순서대로의 Instruction 번호입니다.
+    SmallVector<unsigned, 8> order;
 
   public:
 
+    class iterator
+    {
+      const InstructionDependency *owner;
+      const unsigned *position;
+
+    public:
+
+      iterator(const InstructionDependency *ID, const unsigned *Position)
+        : owner(ID), position(Position) { }
+
+      PairType operator*() const
+      {
+        return PairType(owner->numbering->getInstruction(*position), owner->perfect.test(*position));
+      }
+      iterator& operator++() { ++position; return *this; }
+      bool operator==(const iterator& RHS) const { return position == RHS.position; }
+      bool operator!=(const iterator& RHS) const { return position != RHS.position; }
+    };
+
+    InstructionDependency(const InstructionNumbering *IN)
+      : numbering(IN), perfect(IN->size()), maybe(IN->size()), members(IN->size()) { }
+
     bool hasInstructoin(Instruction *I, bool P = true)
-    { 
-      for (auto& pair : insts) 
-        if (pair.first == I && (pair.second == P || pair.second))
-          return true;
-      return false;
+    {
+      unsigned n = numbering->getNumber(I);
+      return perfect.test(n) || (!P && maybe.test(n));
     }
-    void addInstruction(Instruction *I, bool P = true) 
+    void addInstruction(Instruction *I, bool P = true)
     {
-      for (auto& pair : insts)
-        if (pair.first == I)
-        {
-          if (P) pair.second = true;
-          return;
-        }
-      insts.push_back(PairType(I,P));
+      unsigned n = numbering->getNumber(I);
+      if (perfect.test(n))
+        return;
+      if (!members.test(n)) {
+        members.set(n);
+        order.push_back(n);
+      }
+      if (P) {
+        maybe.reset(n);
+        perfect.set(n);
+      } else {
+        maybe.set(n);
+      }
+    }
+
+    /// Other의 Instruction들을 더합니다. 어느 한 쪽에서라도 Perpect인
+    /// Instruction은 Perpect가 됩니다.
+    void merge(const InstructionDependency& Other)
+    {
+      perfect |= Other.perfect;
+      maybe |= Other.maybe;
+      maybe.reset(perfect);
+      append(Other.members);
+    }
+
+    /// Instruction 번호의 bitmap으로 Instruction들을 더합니다. bitmap의 크기는
+    /// InstructionNumbering의 크기와 같아야 합니다.
+    void merge(const BitVector& Perpect, const BitVector& Maybe)
+    {
+      perfect |= Perpect;
+      maybe |= Maybe;
+      maybe.reset(perfect);
+      BitVector added(Perpect);
+      added |= Maybe;
+      append(added);
     }
 
-    InstsType::iterator begin() { return insts.begin(); }
-    InstsType::const_iterator begin() const { return insts.begin(); }
-    InstsType::iterator end() { return insts.end(); }
-    InstsType::const_iterator end() const { return insts.end(); }
+    const BitVector& getPerpectBits() const { return perfect; }
+    const BitVector& getMaybeBits() const { return maybe; }
+
+    size_t size() const { return order.size(); }
+
+    iterator begin() const { return iterator(this, order.begin()); }
+    iterator end() const { return iterator(this, order.end()); }
+
+  private:
+
+    /// Bits 중 아직 members에 없는 Instruction들을 추가합니다.
+    void append(const BitVector& Bits)
+    {
+      BitVector added(Bits);
+      added.reset(members);
+      for (unsigned n : added.set_bits())
+        order.push_back(n);
+      members |= added;
+    }
   };
   
+  /// annotated variable별 slice의 목록입니다. slice들은 이 map의 arena에
+  /// 할당되며, map이 사라질 때 함께 해제됩니다. 순회 순서는 slice를 만든
+  /// 순서(annotated variable의 순서)입니다.
   class InstructionDependencyMap
   {
-    using ValueMap = std::map<Value *, InstructionDependency *>;
+    using ValueMap = MapVector<Value *, InstructionDependency *>;
     ValueMap value_map;
+    SpecificBumpPtrAllocator<InstructionDependency> allocator;
 
   public:
 
     InstructionDependencyMap() : value_map() { }
-    ~InstructionDependencyMap() { for (auto& id : value_map) delete id.second; }
-    bool hasDependency(Value *V) { return value_map.find(V) != value_map.end(); }
-    InstructionDependency* getDependency(Value *V) { return value_map[V]; }
-    void addDependency(Value *V, InstructionDependency *ID) { value_map[V] = ID; }
+    bool hasDependency(Value *V) { return value_map.count(V); }
+    InstructionDependency* getDependency(Value *V) { return value_map.lookup(V); }
+
+    /// V에 대한 빈 slice를 만들어 추가합니다. 이미 있다면 그 slice를 반환합니다.
+    InstructionDependency *createDependency(Value *V, const InstructionNumbering *IN)
+    {
+      InstructionDependency*& slice = value_map[V];
+      if (!slice)
+        slice = new (allocator.Allocate()) InstructionDependency(IN);
+      return slice;
+    }
 
     ValueMap::iterator begin() { return value_map.begin(); }
     ValueMap::const_iterator begin() const { return value_map.begin(); }
@@ -196,17 +563,27 @@ namespace {
     ValueMap::const_iterator end() const { return value_map.end(); }
   };
 
+  /// 함수인자 번호별 Dependency입니다. 함수인자 번호를 그대로 색인으로 쓰는
+  /// 배열이며, 없는 항목은 nullptr입니다.
   class ArgumentInstructionDependencyMap
   {
-    using IndexMap = std::map<int, InstructionDependency *>;
+    using IndexMap = SmallVector<InstructionDependency *, 8>;
     IndexMap index_map;
 
   public:
 
     ArgumentInstructionDependencyMap() : index_map() { }
-    bool hasDependency(int ArgNo) { return index_map.find(ArgNo) != index_map.end(); }
-    InstructionDependency* getDependency(int ArgNo) { return index_map[ArgNo]; }
-    void addDependency(int ArgNo, InstructionDependency *ID) { index_map[ArgNo] = ID; }
+    bool hasDependency(unsigned ArgNo) { return getDependency(ArgNo) != nullptr; }
+    InstructionDependency* getDependency(unsigned ArgNo)
+    {
+      return ArgNo < index_map.size() ? index_map[ArgNo] : nullptr;
+    }
+    void addDependency(unsigned ArgNo, InstructionDependency *ID)
+    {
+      if (ArgNo >= index_map.size())
+        index_map.resize(ArgNo + 1);
+      index_map[ArgNo] = ID;
+    }
 
     IndexMap::iterator begin() { return index_map.begin(); }
     IndexMap::const_iterator begin() const { return index_map.begin(); }
@@ -214,18 +591,80 @@ namespace {
     IndexMap::const_iterator end() const { return index_map.end(); }
   };
 
-  class FunctionArgumentDependency
+  /// [정보]
+  /// 함수 요약정보를 하나의 비트 행렬로 표현합니다. 행은 함수인자들과
+  /// 반환값(마지막 행)이고, 열은 그 행에 영향을 미치는 함수인자들입니다.
+  ///
+  /// [보충]
+  /// - 각 행은 64비트 word 단위로 채워져 있으므로, 함수인자가 63개 이하라면
+  ///   한 행이 word 하나입니다. 함수인자가 7개 이하라면 행렬 전체가 64바이트
+  ///   안에 들어갑니다.
+  /// - 호출 지점에서 요약정보를 적용할 때는 필요한 행들을 OR하여 따라갈
+  ///   함수인자들의 mask를 만듭니다.
+  /// - 요약정보는 전이적으로 닫지 않습니다. 함수인자를 거쳐 간접적으로
+  ///   전해지는 Dependency는 탐색이 따라가며 Maybe로 기록하는데, 닫아 두면
+  ///   그 Dependency가 직접 Dependency처럼 Perpect로 기록됩니다.
+  class SummaryMatrix
   {
-    Argument *argument;
-    std::vector<bool> argument_dependency;
+  public:
+    using Word = uint64_t;
+    static constexpr unsigned WordBits = 64;
+
+  private:
+    unsigned argc;
+    unsigned row_words;
+    SmallVector<Word, 8> words;
+
+    Word *row(unsigned Row) { return words.data() + Row * row_words; }
 
   public:
 
-    FunctionArgumentDependency(Argument *A, size_t argc)
-      : argument(A), argument_dependency(argc) { }
-    Argument* getArgument() { return argument; }
-    bool hasArgumentDependency(int ix) { return argument_dependency[ix]; }
-    void setArgumentDependency(int ix) { argument_dependency[ix] = true; }
+    SummaryMatrix(unsigned Argc)
+      : argc(Argc), row_words((Argc + WordBits - 1) / WordBits),
+        words((Argc + 1) * row_words) { }
+
+    unsigned getNumArguments() const { return argc; }
+    unsigned getReturnRow() const { return argc; }
+
+    bool test(unsigned Row, unsigned Col) const
+    {
+      return words[Row * row_words + Col / WordBits] >> (Col % WordBits) & 1;
+    }
+    void set(unsigned Row, unsigned Col)
+    {
+      row(Row)[Col / WordBits] |= Word(1) << (Col % WordBits);
+    }
+
+    ArrayRef<Word> getRow(unsigned Row) const
+    {
+      return makeArrayRef(words.data() + Row * row_words, row_words);
+    }
+
+    /// Row 행을 Mask에 OR합니다.
+    void unionRow(unsigned Row, SmallVectorImpl<Word>& Mask) const
+    {
+      Mask.resize(row_words);
+      ArrayRef<Word> source = getRow(Row);
+      for (unsigned w = 0; w < row_words; w++)
+        Mask[w] |= source[w];
+    }
+
+    size_t count() const
+    {
+      size_t count = 0;
+      for (Word word : words)
+        count += countPopulation(word);
+      return count;
+    }
+
+    /// Mask에서 1인 비트의 번호를 작은 것부터 차례로 Fn에 넘깁니다.
+    template <typename FnT>
+    static void forEachBit(ArrayRef<Word> Mask, FnT Fn)
+    {
+      for (unsigned w = 0; w < Mask.size(); w++)
+        for (Word word = Mask[w]; word; word &= word - 1)
+          Fn(w * WordBits + countTrailingZeros(word));
+    }
   };
   
   /// 이 클래스는 다음과 같은 세 가지 정보를 가지고 있습니다.
@@ -236,25 +675,22 @@ namespace {
   class FunctionDependency
   {
     Function *function;
-    std::vector<bool> return_dependency;
-    SmallVector<FunctionArgumentDependency *, 8> arg_dependency;
+    SummaryMatrix summary;
     SmallVector<FunctionDependency *, 8> call_dependency;
     InstructionDependencyMap *insts_map = nullptr;
     InstructionDependency *return_instruction_dependency = nullptr;
     ArgumentInstructionDependencyMap *arg_map = nullptr;
-    BranchManager *branch_manager;
+    ControlDependence *control_dependence = nullptr;
+    InstructionNumbering *numbering = nullptr;
+    ValueAccessIndex *access_index = nullptr;
+    MemoryDependence *memory_dependence = nullptr;
+    bool summary_changed = true;
 
   public:
 
     FunctionDependency(Function *F) 
-      : function (F), return_dependency(F->arg_size()), arg_dependency(F->arg_size()) 
+      : function (F), summary(F->arg_size())
     {
-      branch_manager = new BranchManager(F);
-      for (size_t i = 0; i < F->arg_size(); i++)
-      {
-        Argument *arg = F->arg_begin() + i;
-        arg_dependency[i] = new FunctionArgumentDependency(arg, F->arg_size());
-      }
     }
 
     ~FunctionDependency()
@@ -262,19 +698,75 @@ namespace {
       if (insts_map) delete insts_map;
       if (return_instruction_dependency) delete return_instruction_dependency;
       if (arg_map) delete arg_map;
-      delete branch_manager;
+      releaseWalk();
+    }
+
+    /// [정보]
+    /// 함수 본문을 탐색하는 데 필요한 색인들(control dependence, Instruction
+    /// 번호, ValueAccessIndex, MemoryDependence)을 만듭니다. 이미 있으면
+    /// 아무것도 하지 않습니다.
+    ///
+    /// [보충]
+    /// 요약정보가 확정되면 releaseWalk로 색인들을 해제합니다. 모듈 전체를
+    /// 분석할 때 피호출 함수들의 색인이 끝까지 남아 있지 않게 하기 위함입니다.
+    /// 캐시에서 요약정보를 불러온 함수는 색인을 만들지 않습니다.
+    void prepareWalk()
+    {
+      if (control_dependence)
+        return;
+      prepareNumbering();
+      control_dependence = new ControlDependence(function);
+      access_index = new ValueAccessIndex(function);
+      if (IDCMemorySSA && !function->isIntrinsic() && !function->empty())
+        memory_dependence = new MemoryDependence(function);
+    }
+
+    /// Instruction 번호만 만듭니다. 기록에서 불러온 slice처럼 탐색하지 않는
+    /// 경우에 사용합니다.
+    void prepareNumbering()
+    {
+      if (!numbering)
+        numbering = new InstructionNumbering(function);
+    }
+
+    void releaseWalk()
+    {
+      delete control_dependence;
+      delete numbering;
+      delete access_index;
+      delete memory_dependence;
+      control_dependence = nullptr;
+      numbering = nullptr;
+      access_index = nullptr;
+      memory_dependence = nullptr;
     }
 
     Function* getFunction() { return function; }
 
     /// 반환값에 영향을 미치는 함수인자를 알아볼 수 있습니다.
-    bool hasReturnDependency(int ix) { return return_dependency[ix]; }
-    void setReturnDependency(int ix) { return_dependency[ix] = true; }
+    bool hasReturnDependency(int ix) { return summary.test(summary.getReturnRow(), ix); }
+    void setReturnDependency(int ix) { summary.set(summary.getReturnRow(), ix); }
+
+    /// 함수인자 ix2가 포인터 함수인자 ix에 영향을 미치는지 알아볼 수 있습니다.
+    bool hasArgumentDependency(int ix, int ix2) { return summary.test(ix, ix2); }
+    void setArgumentDependency(int ix, int ix2) { summary.set(ix, ix2); }
+
+    const SummaryMatrix& getSummary() { return summary; }
 
-    /// 어떤 함수인자가 특정 함수인자에 영향을 미치는지 알아볼 수 있습니다.
-    FunctionArgumentDependency *getFunctionArgumentDependency(size_t i) { return arg_dependency[i]; }
+    /// 반환값과 함수인자에 대한 Dependency의 개수입니다. 이 값은 줄어들지 않으므로
+    /// SCC 내부의 fixpoint 계산에서 요약정보의 변화 여부를 판단하는 데 쓰입니다.
+    size_t countDependencies() { return summary.count(); }
 
-    void addFunctionDependency(FunctionDependency *FD) { call_dependency.push_back(FD); }
+    /// 요약정보가 이전 분석(-idc-incremental)과 달라졌는지 알아볼 수 있습니다.
+    /// 이전 분석이 없으면 항상 true입니다.
+    bool isSummaryChanged() { return summary_changed; }
+    void setSummaryChanged(bool Changed) { summary_changed = Changed; }
+
+    void addFunctionDependency(FunctionDependency *FD)
+    {
+      if (!is_contained(call_dependency, FD))
+        call_dependency.push_back(FD);
+    }
     size_t getFunctionDependencyNum() { return call_dependency.size(); }
     FunctionDependency* getFunctionDependency(size_t i) { return call_dependency[i]; }
 
@@ -290,20 +782,40 @@ namespace {
     void setArgumentInstructionDependencyMap(ArgumentInstructionDependencyMap *AIDM) { arg_map = AIDM; }
     ArgumentInstructionDependencyMap *getArgumentInstructionDependencyMap() { return arg_map; }
 
-    BranchManager *getBranchManager() { return branch_manager; }
+    ControlDependence *getControlDependence() { return control_dependence; }
+    InstructionNumbering *getInstructionNumbering() { return numbering; }
+    ValueAccessIndex *getAccessIndex() { return access_index; }
+
+    /// -idc-memssa가 꺼져 있으면 nullptr입니다.
+    MemoryDependence *getMemoryDependence() { return memory_dependence; }
   };
   
+  /// [정보]
+  /// 함수별 FunctionDependency의 목록입니다.
+  ///
+  /// [보충]
+  /// - FunctionDependency는 createDependency로 이 map의 arena에 할당되며,
+  ///   map이 사라질 때 모두 함께 해제됩니다. 할당과 addDependency로 등록하는
+  ///   시점은 다를 수 있습니다. (피호출 함수는 분석이 끝난 뒤 등록됩니다.)
+  /// - createDependency는 분석을 시작한 스레드에서만 호출됩니다. 다른
+  ///   스레드들은 미리 만들어진 FunctionDependency를 읽고 갱신할 뿐입니다.
   class DependencyMap
   {
-    using FunctionMap = std::map<Function *, FunctionDependency *>;
+    using FunctionMap = DenseMap<Function *, FunctionDependency *>;
     FunctionMap function_map;
+    SpecificBumpPtrAllocator<FunctionDependency> allocator;
 
   public:
 
     DependencyMap() : function_map() { }
-    ~DependencyMap() { for (auto& fd : function_map) delete fd.second; }
-    bool hasDependency(Function *F) { return function_map.find(F) != function_map.end(); }
-    FunctionDependency* getDependency(Function *F) { return function_map[F]; }
+
+    FunctionDependency *createDependency(Function *F)
+    {
+      return new (allocator.Allocate()) FunctionDependency(F);
+    }
+
+    bool hasDependency(Function *F) { return function_map.count(F); }
+    FunctionDependency* getDependency(Function *F) { return function_map.lookup(F); }
     void addDependency(Function *F, FunctionDependency *FD) { function_map[F] = FD; }
   };
   
@@ -313,747 +825,3182 @@ namespace {
   ///
   ///---------------------------------------------------------
   
-  static DependencyMap *recursion_map;
+  /// [정보]
+  /// 피호출 함수를 그 자리에서 분석하는 경우, 분석 중인 함수들을 기록하여
+  /// 재귀호출을 끊습니다.
+  ///
+  /// [보충]
+  /// - 스레드마다 따로 존재합니다. 모듈 단위 분석에서는 모든 요약정보가 미리
+  ///   준비되어 있으므로 사용하지 않으며(nullptr), 이때 작업 스레드들은 이
+  ///   변수를 공유하지 않습니다.
+  static thread_local DependencyMap *recursion_map = nullptr;
+
+  /// 여러 스레드에서 콘솔에 메시지를 출력할 때 사용합니다.
+  static std::mutex output_mutex;
+
+  /// [정보]
+  /// DependencyWalker의 탐색을 컴파일 시간에 특수화하는 설정입니다.
+  /// walk가 -idc-print-instruction, -idc-scan-control-flow의 값에 맞는 것을
+  /// 골라 사용하므로, 꺼진 기능은 탐색 중에 검사하지 않습니다.
+  template <bool Trace, bool ScanControlFlow>
+  struct WalkPolicy
+  {
+    static constexpr bool TraceInstructions = Trace;
+    static constexpr bool FollowBranches = ScanControlFlow;
+  };
 
-  class DependencyChecker
+  /// [정보]
+  /// runBottomUp, runSearch, processBlock이 서로를 재귀호출하던 탐색을
+  /// 명시적인 작업 스택 위에서 수행하는 공통 탐색 엔진입니다. 세 Checker는
+  /// 이 클래스를 상속하여 탐색 중 만나는 대상을 어떻게 처리할지만 정의합니다.
+  ///
+  /// [보충]
+  /// - 작업은 재귀호출 때와 같은 깊이 우선 순서로 처리됩니다. 한 작업이 만든
+  ///   자식 작업들은 호출 순서대로 쌓인 뒤 뒤집히기 때문입니다.
+  /// - Instruction은 Maybe에서 Perpect로 바뀔 때를 포함해 최대 두 번, 같은
+  ///   (V, P)에 대한 Search와 각 블록은 한 번만 처리되므로 작업 스택의 크기는
+  ///   의존성 그래프의 간선 수를 넘지 않습니다.
+  /// - Derived 클래스가 정의할 수 있는 함수들은 다음과 같습니다.
+  ///   visitArgument, visitValue, followStore, followStoredValue, followLoad,
+  ///   followCallArgument, resolveSearch, shouldPause
+  template <typename Derived>
+  class DependencyWalker
   {
-  public:
+    enum WorkKind { WK_BottomUp, WK_Search, WK_Block };
 
-    static void run(FunctionDependency *FD, DependencyMap *DM)
+    struct WorkItem
     {
-      if (FD->getFunction()->isIntrinsic()) return;
-      if (FD->getFunction()->empty()) {
-#if IDC_PRINT_MSG_EMPTY_FUNCTION
-        errs() << "Function is not defined!\n";
-#endif
-#if IDC_EMPTY_FUNCTION_PARAM_AFFECT_RETURN
-        for (size_t argc = 0; argc < FD->getFunction()->arg_size(); argc++)
-          FD->setReturnDependency(argc);
-#endif
-        return;
-      }
+      WorkKind kind;
+      Value *value;
+      BasicBlock *block;
+      bool perfect;
+      bool root;
+    };
 
-      /// 어떤 함수인자가 반환값에 영향을 미치는지 검사합니다.
-      FunctionReturnDependencyChecker return_checker(FD, DM);
+    using SearchKey = PointerIntPair<Value *, 2, unsigned>;
+    using BlockKey = PointerIntPair<BasicBlock *, 1, bool>;
 
-      /// 어떤 함수인자가 특정 함수인자에 미치는 영향을 검사합니다.
-      FunctionArgumentDependencyCheck argument_checker(FD, DM);
+    SmallVector<WorkItem, 64> worklist;
+    DenseSet<SearchKey> searched;
+    DenseSet<BlockKey> blocks;
+
+  protected:
+
+    Function *function;
+    DependencyMap *dependency_map;
+    FunctionDependency *function_dependency;
+    InstructionDependency *inst_dependency = nullptr;
+
+    /// Derived 클래스에서 true로 다시 정의하면 runBottomUp이 자기 자신에 대한
+    /// runSearch를 함께 수행하고, Operand에 대해서는 runBottomUp만 수행합니다.
+    /// (runChecker의 방식)
+    static constexpr bool FusedSearch = false;
+
+    DependencyWalker(FunctionDependency *FD, DependencyMap *DM)
+      : function(FD->getFunction()), dependency_map(DM), function_dependency(FD) { }
+
+    Derived& derived() { return *static_cast<Derived *>(this); }
+
+    /// 새로운 탐색을 시작합니다. Search와 블록의 방문 기록이 초기화됩니다.
+    void startWalk()
+    {
+      worklist.clear();
+      searched.clear();
+      blocks.clear();
     }
 
-    class FunctionReturnDependencyChecker
+    void pushBottomUp(Value *V, bool P = true)
     {
-      Function *function;
-      DependencyMap *dependency_map;
-      FunctionDependency *function_dependency;
-      InstructionDependency *inst_dependency; // used only checking overlapping
-      std::vector<BlockNode *> block_nodes;
+      worklist.push_back({ WK_BottomUp, V, nullptr, P, false });
+    }
+    void pushSearch(Value *V, bool P = true, bool ROOT = false)
+    {
+      worklist.push_back({ WK_Search, V, nullptr, P, ROOT });
+    }
 
-    public:
+    /// V를 Operand로 따라갑니다. (runBottomUp + runSearch)
+    void pushOperand(Value *V, bool P = true)
+    {
+      pushBottomUp(V, P);
+      if (!Derived::FusedSearch)
+        pushSearch(V, P);
+    }
 
-      FunctionReturnDependencyChecker(FunctionDependency *FD, DependencyMap *DM)
-        : function_dependency(FD), dependency_map(DM)
-      {
-        function = function_dependency->getFunction();
-        recursion_map->addDependency(function, nullptr);
+    /// Search 작업을 처리하기 전에 resolveSearch가 결정하는 처리 방법입니다.
+    enum SearchAction
+    {
+      SA_Expand,    ///< 평소처럼 탐색합니다.
+      SA_Skip,      ///< Derived 클래스가 이미 처리했으므로 건너뜁니다.
+      SA_Suspend    ///< 작업을 남겨 둔 채 탐색을 멈춥니다.
+    };
 
-        for (BasicBlock& basic_block : *function)
-          for (Instruction& inst : basic_block)
-            if (ReturnInst *ri = dyn_cast<ReturnInst>(&inst)) {
+    /// walk가 멈춘 이유입니다.
+    enum WalkResult
+    {
+      WR_Done,      ///< 작업 스택이 비었습니다.
+      WR_Suspended, ///< resolveSearch가 SA_Suspend를 반환했습니다.
+      WR_Paused     ///< shouldPause가 true를 반환했습니다.
+    };
 
-              // 반환되는 내용은 반드시 ReturnInst를 거쳐야됩니다. 따라서 ReturnInst의
-              // Operand에 영향을 미치는 것들을 차례로 조사합니다. 이 과정은 함수 내부에
-              // 모든 ReturnInst를 조사합니다.
-              inst_dependency = new InstructionDependency();
-              runBottomUp(ri->getReturnValue());
-              delete inst_dependency;
-            }
-      }
+    /// 작업 스택이 빌 때까지 탐색합니다. resolveSearch가 SA_Suspend를
+    /// 반환하면 그 Search 작업을 남겨 둔 채, shouldPause가 true를 반환하면
+    /// 방금 처리한 작업 다음에서 멈춥니다. 다시 walk를 호출하면 남은 작업부터
+    /// 이어서 탐색합니다.
+    WalkResult walk()
+    {
+      if (IDCPrintInstruction)
+        return IDCScanControlFlow ? walkWith<WalkPolicy<true, true>>()
+                                  : walkWith<WalkPolicy<true, false>>();
+      return IDCScanControlFlow ? walkWith<WalkPolicy<false, true>>()
+                                : walkWith<WalkPolicy<false, false>>();
+    }
 
-    private:
-      
-      /// [정보]
-      /// 어떤 함수인자가 V에 영향을 미치는지 검사합니다. 이 과정은
-      /// 재귀적으로 진행됩니다.
-      void runBottomUp(Value *V, bool P = true)
-      {
-        if (Argument *arg = dyn_cast<Argument> (V)) {
-          function_dependency->setReturnDependency(arg->getArgNo());
-          return;
-        }
-        
-        if (Instruction *inst = dyn_cast <Instruction> (V))
-        {
-          if (inst_dependency->hasInstructoin(inst, P))
-            return;
-
-#if IDC_PRINT_INSTRUCTION
-          errs() << "    (" << function->getName() << ")" << *inst << "\n";
-#endif
-
-          inst_dependency->addInstruction(inst, P);
-
-          // PHINode와 기타 Instruction은 Operand에 접근하는 방법이 다릅니다.
-          // 따라서 두 가지 분리하여 검사하였습니다.
-          // 다른 접근 방법을 가진 Instruction은 여기서 특수화 해야합니다.
-          if (PHINode *phi = dyn_cast<PHINode> (inst)) {
-            for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
-              Value *target_value = phi->getIncomingValue(i);
-              runBottomUp(target_value, P);
-              runSearch(target_value, P);
-            }
-          } else if (CallInst *ci = dyn_cast<CallInst> (inst)) {
-            
-            // 어떤 함수인자가 반환값에 영향을 미칩니까?
-            FunctionDependency *depends;
-            if (!(depends = processCallInst(ci))) return;
-
-            // 반환값에 영향을 미치는 모든 함수인자들은 V에 영향을 미치게 됩니다.
-            for (size_t i = 0; i < ci->getCalledFunction()->arg_size(); i++)
-              if (depends->hasReturnDependency(i) == true) {
-                runBottomUp(ci->getOperand(i), P);
-                runSearch(ci->getOperand(i), P);
-              }
+    FunctionDependency *processCallInst(CallInst *CI);
 
-          } else {
+    ///
+    /// 기본 동작들입니다. Derived 클래스에서 다시 정의할 수 있습니다.
+    ///
 
-            for (unsigned i = 0; i < inst->getNumOperands(); i++) {
-              Value *target_value = inst->getOperand(i);
-              runBottomUp(target_value, P);
-              runSearch(target_value, P);
-            }
-          }
+    void visitArgument(Argument *, bool) { }
 
-          processBranches(V);
-        }
-      }
-      
-      /// [정보]
-      /// CallInst에 의해 호출된 함수의 Dependency를 가져옵니다.
-      ///
-      /// [보충]
-      /// - callinst를 만났을 경우 다음과 같은 두 가지 영향을 분석합니다.
-      ///   1. 반환값에 영향을 미치는 함수인자들의 목록
-      ///   2. 포인터 함수인자에 영향을 미치는 함수인자들의 목록
-      /// - 이 함수와 동일한 이름을 갖는 함수는 모두 같은 기능을 가집니다.
-      FunctionDependency *processCallInst(CallInst *CI)
-      {
-        FunctionDependency *depends = nullptr;
-        Function *target_function = CI->getCalledFunction();
+    SearchAction resolveSearch(Value *, bool, bool) { return SA_Expand; }
+    bool shouldPause() { return false; }
 
-        if (dependency_map->hasDependency(target_function)) {
-          depends = dependency_map->getDependency(target_function);
-        } else {
-          if (recursion_map->hasDependency(target_function))
-            return nullptr;
-          depends = new FunctionDependency(target_function);
-          run(depends, dependency_map);
-          dependency_map->addDependency(target_function, depends);
-        }
+    /// V를 처음 방문하거나 Maybe에서 Perpect로 방문하는 경우에만 true를
+    /// 반환하여 V의 Operand들을 따라가게 합니다.
+    bool visitValue(Value *V, bool P)
+    {
+      Instruction *inst = dyn_cast<Instruction> (V);
+      if (!inst || inst_dependency->hasInstructoin(inst, P))
+        return false;
 
-        function_dependency->addFunctionDependency(depends);
+      inst_dependency->addInstruction(inst, P);
+      return true;
+    }
 
-        return depends;
-      }
+    void followStoredValue(StoreInst *, bool) { }
+    void followLoad(LoadInst *, bool) { }
 
-      /// [정보]
-      /// V가 속한 블록에 영향을 미치는 블록을 찾습니다.
-      void processBranches(Value *V)
+  private:
+
+    template <typename Policy>
+    WalkResult walkWith()
+    {
+      while (!worklist.empty())
       {
-#if IDC_SCAN_CONTROL_FLOW
-        if (Instruction *inst = dyn_cast<Instruction> (V))
-        {
-          BranchManager *bm = function_dependency->getBranchManager();
-          BlockNode *this_node = bm->getNodeFromInstruction(inst);
-          processBlock(this_node);
+        WorkItem item = worklist.back();
+        if (item.kind == WK_Search) {
+          SearchAction action = derived().resolveSearch(item.value, item.perfect, item.root);
+          if (action == SA_Suspend)
+            return WR_Suspended;
+          if (action == SA_Skip) {
+            worklist.pop_back();
+            continue;
+          }
         }
-#endif
-      }
-      
-      void processBlock(BlockNode *BN)
-      {
-        bool is_perpect = BN->getFromNodes().size() == 1;
-        for (BlockNode *bn : BN->getFromNodes())
+
+        worklist.pop_back();
+        size_t mark = worklist.size();
+
+        switch (item.kind)
         {
-          for (BlockNode *x : block_nodes)
-            if (x == bn) return;
-          block_nodes.push_back(bn);
-          if (bn->getBranchInst()->isConditional()) {
-            runBottomUp(bn->getBranchInst()->getCondition(), is_perpect);
-            runSearch(bn->getBranchInst()->getCondition(), is_perpect);
-          }
-          processBlock(bn);
+        case WK_BottomUp: runBottomUp<Policy>(item.value, item.perfect); break;
+        case WK_Search: runSearch<Policy>(item.value, item.perfect, item.root); break;
+        case WK_Block: processBlock(item.block, item.perfect); break;
         }
-      }
 
-      /// [정보]
-      /// Node따라가기에서 찾지못하는 특정 변수의 Dependency를 분석하기 위해
-      /// 몇 가지 조건을 검사합니다. 이 단계에선 [보충]경우에서의 Dependency를
-      /// 예상할 뿐 확신을 할 수는 없습니다.
-      /// 
-      /// [보충]
-      /// - 현재까지 다음과 같은 세 가지 경우에서만 변수를 변경될 수 있음을
-      ///   확인했습니다.
-      ///   1. StoreInst: StoreInst는 register에 값을 쓰는 역할을 담당합니다.
-      ///      따라서 StoreInst의 Pointer가 찾으려는 변수일 경우를 확인합니다.
-      ///   2. LoadInst: LoadInst의 Pointer가 찾으려는 변수일 경우, LoadInst
-      ///      그 자체가 해당 변수를 담당할 수 있습니다.
-      ///   3. CallInst: 찾으려는 변수가 포인터형태의 함수인자로 어떤 함수에 넘겨지는 
-      ///      경우 해당 함수의 다른 함수인자들이 이 변수에 영향을 미칠 수 있습니다.
-      void runSearch(Value *V, bool P = true)
-      {
-        for (BasicBlock& basic_block : *function)
-          for (Instruction& inst : basic_block) {
-            if (StoreInst *si = dyn_cast<StoreInst> (&inst))
-            {
-              if (si->getPointerOperand() == V)
-                runBottomUp(si->getValueOperand());
-            }
-            else if (CallInst *ci = dyn_cast<CallInst> (&inst))
-            {
-              FunctionDependency *depends;
-              if (!(depends = processCallInst(ci))) continue;
-              for (size_t i = 0; i < depends->getFunction()->arg_size(); i++)
-                if (depends->getFunctionArgumentDependency(i)->getArgument() == V)
-                  for (size_t j = 0; j < depends->getFunction()->arg_size(); j++)
-                    if (depends->getFunctionArgumentDependency(i)->hasArgumentDependency(j))
-                      runBottomUp(depends->getFunctionArgumentDependency(j)->getArgument(), P);
-            }
-          }
-        processBranches(V);
+        std::reverse(worklist.begin() + mark, worklist.end());
+        if (derived().shouldPause())
+          return WR_Paused;
       }
+      return WR_Done;
+    }
 
-    };
+    /// [정보]
+    /// V에 영향을 미치는 Operand들을 따라갑니다.
+    template <typename Policy>
+    void runBottomUp(Value *V, bool P)
+    {
+      if (!V) return;
+
+      if (Argument *arg = dyn_cast<Argument> (V)) {
+        derived().visitArgument(arg, P);
+        return;
+      }
+
+      if (!derived().visitValue(V, P))
+        return;
+
+      if (Policy::TraceInstructions) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        errs() << "    (" << function->getName() << ")" << *V << "\n";
+      }
+
+      if (Derived::FusedSearch)
+        pushSearch(V, P);
+
+      Instruction *inst = dyn_cast<Instruction> (V);
+      if (!inst) return;
+
+      // PHINode와 기타 Instruction은 Operand에 접근하는 방법이 다릅니다.
+      // 따라서 두 가지 분리하여 검사하였습니다.
+      // 다른 접근 방법을 가진 Instruction은 여기서 특수화 해야합니다.
+      if (PHINode *phi = dyn_cast<PHINode> (inst)) {
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+          pushOperand(phi->getIncomingValue(i), P);
+      } else if (CallInst *ci = dyn_cast<CallInst> (inst)) {
+
+        // 반환값에 영향을 미치는 모든 함수인자들은 V에 영향을 미치게 됩니다.
+        if (FunctionDependency *depends = processCallInst(ci)) {
+          const SummaryMatrix& summary = depends->getSummary();
+          SummaryMatrix::forEachBit(summary.getRow(summary.getReturnRow()),
+            [&](unsigned i) { pushOperand(ci->getArgOperand(i), P); });
+        }
+
+      } else if (isa<LoadInst> (inst) && !Derived::FusedSearch &&
+                 function_dependency->getMemoryDependence()) {
+        processLoad(cast<LoadInst> (inst), P);
+      } else {
+        for (unsigned i = 0; i < inst->getNumOperands(); i++)
+          pushOperand(inst->getOperand(i), P);
+      }
+
+      if (!Derived::FusedSearch)
+        processBranches<Policy>(V, P);
+    }
+
+    /// [정보]
+    /// Node따라가기에서 찾지못하는 특정 변수의 Dependency를 분석하기 위해
+    /// 몇 가지 조건을 검사합니다. 이 단계에선 [보충]경우에서의 Dependency를
+    /// 예상할 뿐 확신을 할 수는 없습니다.
+    /// 
+    /// [보충]
+    /// - 현재까지 다음과 같은 세 가지 경우에서만 변수를 변경될 수 있음을
+    ///   확인했습니다.
+    ///   1. StoreInst: StoreInst는 register에 값을 쓰는 역할을 담당합니다.
+    ///      따라서 StoreInst의 Pointer가 찾으려는 변수일 경우를 확인합니다.
+    ///   2. LoadInst: LoadInst의 Pointer가 찾으려는 변수일 경우, LoadInst
+    ///      그 자체가 해당 변수를 담당할 수 있습니다.
+    ///   3. CallInst: 찾으려는 변수가 포인터형태의 함수인자로 어떤 함수에 넘겨지는 
+    ///      경우 해당 함수의 다른 함수인자들이 이 변수에 영향을 미칠 수 있습니다.
+    template <typename Policy>
+    void runSearch(Value *V, bool P, bool ROOT)
+    {
+      if (!searched.insert(SearchKey(V, (P ? 1 : 0) | (ROOT ? 2 : 0))).second)
+        return;
+
+      for (Instruction *inst : function_dependency->getAccessIndex()->getAccesses(V)) {
+        if (StoreInst *si = dyn_cast<StoreInst> (inst))
+        {
+          if (si->getPointerOperand() == V)
+            derived().followStore(si, P, ROOT);
+          else
+            derived().followStoredValue(si, P);
+        }
+        else if (LoadInst *li = dyn_cast<LoadInst> (inst))
+        {
+          derived().followLoad(li, P);
+        }
+        else if (CallInst *ci = dyn_cast<CallInst> (inst))
+        {
+          FunctionDependency *depends;
+          if (!(depends = processCallInst(ci))) continue;
+
+          // V가 넘겨진 함수인자들의 행을 합쳐 따라갈 함수인자들을 구합니다.
+          const SummaryMatrix& summary = depends->getSummary();
+          SmallVector<SummaryMatrix::Word, 1> mask;
+          for (unsigned i = 0; i < summary.getNumArguments(); i++)
+            if (ci->getArgOperand(i) == V)
+              summary.unionRow(i, mask);
+          SummaryMatrix::forEachBit(mask,
+            [&](unsigned j) { derived().followCallArgument(ci->getArgOperand(j), P, ROOT); });
+        }
+      }
+      processBranches<Policy>(V, P);
+    }
+
+    /// [정보]
+    /// -idc-memssa에서 LoadInst가 읽는 값을 쓴 Instruction들을 따라갑니다.
+    /// 포인터는 주소 계산만 따라가고, 포인터가 같은 StoreInst를 찾는 Search는
+    /// 하지 않습니다.
+    ///
+    /// [보충]
+    /// - reaching definition이 하나뿐이고 MustAlias인 StoreInst일 때만 P를
+    ///   유지하고, 나머지는 Maybe로 따라갑니다.
+    /// - StoreInst가 아닌 definition(CallInst, memcpy 등)은 그 자체와 모든
+    ///   함수인자를 Maybe로 따라갑니다.
+    void processLoad(LoadInst *LI, bool P)
+    {
+      pushBottomUp(LI->getPointerOperand(), P);
+
+      auto definitions = function_dependency->getMemoryDependence()->getDefinitions(LI);
+      for (auto definition : definitions)
+      {
+        Instruction *def = definition.getPointer();
+        if (StoreInst *si = dyn_cast<StoreInst> (def)) {
+          bool is_perpect = P && definition.getInt() && definitions.size() == 1;
+          pushOperand(si->getValueOperand(), is_perpect);
+          continue;
+        }
+
+        pushBottomUp(def, false);
+        if (CallBase *cb = dyn_cast<CallBase> (def))
+          for (Value *arg : cb->args())
+            pushOperand(arg, false);
+      }
+    }
+
+    /// [정보]
+    /// V가 속한 블록의 실행 여부를 결정하는 분기들을 찾습니다.
+    template <typename Policy>
+    void processBranches(Value *V, bool P)
+    {
+      if (!Policy::FollowBranches)
+        return;
+      if (Instruction *inst = dyn_cast<Instruction> (V))
+        worklist.push_back({ WK_Block, nullptr, inst->getParent(), P, false });
+    }
+
+    /// [정보]
+    /// BB가 control dependent한 분기들의 조건을 따라가고, 그 분기 블록들이
+    /// control dependent한 분기들도 이어서 따라갑니다.
+    ///
+    /// [보충]
+    /// 분기 조건은 V와 같은 P로 따라갑니다. control dependence는 실제로 실행
+    /// 여부를 결정하므로, V가 Perpect라면 그 분기 조건도 Perpect입니다.
+    void processBlock(BasicBlock *BB, bool P)
+    {
+      if (!blocks.insert(BlockKey(BB, P)).second)
+        return;
+      ControlDependence *cd = function_dependency->getControlDependence();
+      for (BasicBlock *controller : cd->getControllingBlocks(BB)) {
+        pushOperand(ControlDependence::getCondition(controller), P);
+        worklist.push_back({ WK_Block, nullptr, controller, P, false });
+      }
+    }
+  };
+
+  class DependencyChecker
+  {
+  public:
+
+    static void run(FunctionDependency *FD, DependencyMap *DM)
+    {
+      if (FD->getFunction()->isIntrinsic()) return;
+      if (FD->getFunction()->empty()) {
+        if (IDCPrintEmptyFunction) {
+          std::lock_guard<std::mutex> lock(output_mutex);
+          errs() << "Function is not defined!\n";
+        }
+        if (IDCEmptyFunctionAffectsReturn)
+          for (size_t argc = 0; argc < FD->getFunction()->arg_size(); argc++)
+            FD->setReturnDependency(argc);
+        return;
+      }
+
+      FD->prepareWalk();
+
+      /// 어떤 함수인자가 반환값에 영향을 미치는지 검사합니다.
+      FunctionReturnDependencyChecker return_checker(FD, DM);
+
+      /// 어떤 함수인자가 특정 함수인자에 미치는 영향을 검사합니다.
+      FunctionArgumentDependencyCheck argument_checker(FD, DM);
+    }
+
+    class FunctionReturnDependencyChecker
+      : public DependencyWalker<FunctionReturnDependencyChecker>
+    {
+      friend class DependencyWalker<FunctionReturnDependencyChecker>;
+
+    public:
+
+      FunctionReturnDependencyChecker(FunctionDependency *FD, DependencyMap *DM)
+        : DependencyWalker(FD, DM)
+      {
+        if (recursion_map)
+          recursion_map->addDependency(function, nullptr);
+
+        for (BasicBlock& basic_block : *function)
+          for (Instruction& inst : basic_block)
+            if (ReturnInst *ri = dyn_cast<ReturnInst>(&inst)) {
+
+              // 반환되는 내용은 반드시 ReturnInst를 거쳐야됩니다. 따라서 ReturnInst의
+              // Operand에 영향을 미치는 것들을 차례로 조사합니다. 이 과정은 함수 내부에
+              // 모든 ReturnInst를 조사합니다.
+              InstructionDependency overlap(function_dependency->getInstructionNumbering());
+              inst_dependency = &overlap;
+              startWalk();
+              pushBottomUp(ri->getReturnValue());
+              walk();
+              inst_dependency = nullptr;
+            }
+      }
+
+    private:
+      
+      /// 반환값에 영향을 미치는 함수인자를 기록합니다.
+      void visitArgument(Argument *A, bool)
+      {
+        function_dependency->setReturnDependency(A->getArgNo());
+      }
+
+      void followStore(StoreInst *SI, bool, bool)
+      {
+        pushBottomUp(SI->getValueOperand());
+      }
+
+      void followCallArgument(Value *V, bool P, bool)
+      {
+        pushBottomUp(V, P);
+      }
+
+    };
 
     class FunctionArgumentDependencyCheck
+      : public DependencyWalker<FunctionArgumentDependencyCheck>
     {
-      Function *function;
-      DependencyMap *dependency_map;
-      FunctionDependency *function_dependency;
-      std::vector<Value *> overlap;
-      std::vector<BlockNode *> block_nodes;
+      friend class DependencyWalker<FunctionArgumentDependencyCheck>;
+
+      static constexpr bool FusedSearch = true;
+
+      Argument *argument;
+      DenseSet<Value *> overlap;
 
     public:
 
       FunctionArgumentDependencyCheck(FunctionDependency *FD, DependencyMap *DM)
-        : function_dependency(FD), dependency_map(DM)
+        : DependencyWalker(FD, DM)
       {
-        function = function_dependency->getFunction();
-        recursion_map->addDependency(function, nullptr);
+        if (recursion_map)
+          recursion_map->addDependency(function, nullptr);
 
         for (Argument *arg = function->arg_begin(); arg != function->arg_end(); arg++)
           if (arg->getType()->isPointerTy())
             for (Argument *arg2 = function->arg_begin(); arg2 != function->arg_end(); arg2++)
               if (arg != arg2) {
+                argument = arg;
                 overlap.clear();
-                runChecker(arg, arg2);
+                startWalk();
+                pushBottomUp(arg2);
+                walk();
               }
       }
 
     private:
 
-      FunctionDependency *processCallInst(CallInst *CI)
+      /// [정보]
+      /// 검사하려는 함수인자 A와 같은 V가 있는지 검사합니다.
+      /// runBottomUp과 runSearch를 합한 형태(runChecker)로 탐색합니다.
+      void visitArgument(Argument *A, bool)
       {
-        FunctionDependency *depends = nullptr;
-        Function *target_function = CI->getCalledFunction();
+        function_dependency->setArgumentDependency(argument->getArgNo(), A->getArgNo());
+      }
 
-        if (dependency_map->hasDependency(target_function)) {
-          depends = dependency_map->getDependency(target_function);
-        } else {
-          if (recursion_map->hasDependency(target_function))
-            return nullptr;
-          depends = new FunctionDependency(target_function);
-          run(depends, dependency_map);
-          dependency_map->addDependency(target_function, depends);
+      bool visitValue(Value *V, bool)
+      {
+        // 이 탐색은 무한재귀 성질을 가지므로 중복검사를 시행합니다.
+        return overlap.insert(V).second;
+      }
+
+      void followStore(StoreInst *SI, bool P, bool)
+      {
+        pushBottomUp(SI->getValueOperand(), P);
+      }
+
+      void followStoredValue(StoreInst *SI, bool P)
+      {
+        pushBottomUp(SI->getPointerOperand(), P);
+      }
+
+      void followLoad(LoadInst *LI, bool P)
+      {
+        pushBottomUp(LI, P);
+      }
+
+      void followCallArgument(Value *V, bool P, bool)
+      {
+        pushBottomUp(V, P);
+      }
+
+    };
+
+  };
+
+  /// [정보]
+  /// CallInst에 의해 호출된 함수의 Dependency를 가져옵니다.
+  ///
+  /// [보충]
+  /// - callinst를 만났을 경우 다음과 같은 두 가지 영향을 분석합니다.
+  ///   1. 반환값에 영향을 미치는 함수인자들의 목록
+  ///   2. 포인터 함수인자에 영향을 미치는 함수인자들의 목록
+  /// - 분석 중인 함수를 다시 호출하는 경우(재귀) nullptr을 반환합니다.
+  template <typename Derived>
+  FunctionDependency *DependencyWalker<Derived>::processCallInst(CallInst *CI)
+  {
+    FunctionDependency *depends = nullptr;
+    Function *target_function = CI->getCalledFunction();
+    if (!target_function) return nullptr;
+
+    // dependency_map에는 nullptr이 등록되지 않으므로 한 번만 찾아봅니다.
+    if (!(depends = dependency_map->getDependency(target_function))) {
+      // 모듈 단위 분석에서는 모든 요약정보가 미리 만들어져 있어야 합니다.
+      // 요약정보가 없는 함수를 이 자리에서 분석하지 않습니다.
+      if (!recursion_map || recursion_map->hasDependency(target_function))
+        return nullptr;
+      depends = dependency_map->createDependency(target_function);
+      DependencyChecker::run(depends, dependency_map);
+      depends->releaseWalk();
+      dependency_map->addDependency(target_function, depends);
+    }
+
+    function_dependency->addFunctionDependency(depends);
+
+    return depends;
+  }
+  
+  /// [정보]
+  /// 함수 요약정보(반환값 Dependency와 함수인자 간 Dependency)를 디스크에
+  /// 저장하고 불러옵니다.
+  ///
+  /// [보충]
+  /// - 요약정보는 함수 본문의 해시와 그 함수가 속한 SCC의 해시로 만든 키로
+  ///   저장됩니다. SCC의 해시는 구성원들의 해시와 피호출 SCC들의 해시를 합한
+  ///   것이므로, 어떤 피호출 함수가 바뀌면 호출하는 함수들의 키도 바뀝니다.
+  /// - 분석 방식을 결정하는 설정값들도 해시에 포함됩니다.
+  /// - 파일은 임시 파일에 쓴 뒤 이름을 바꾸므로, 여러 opt가 같은 디렉터리를
+  ///   동시에 사용해도 읽는 쪽이 쓰다 만 파일을 보지 않습니다.
+  class SummaryCache
+  {
+    static constexpr unsigned SummaryVersion = 5;
+
+    std::string directory;
+
+  public:
+
+    SummaryCache(StringRef Directory) : directory(Directory.str())
+    {
+      sys::fs::create_directories(directory);
+    }
+
+    /// [정보]
+    /// 모듈의 모든 함수 본문(선언인 경우 signature)의 해시입니다.
+    ///
+    /// [보충]
+    /// - Function::print는 호출할 때마다 모듈 전체를 훑으므로, 모듈을 한 번
+    ///   출력하면서 각 함수가 시작하는 위치를 기록하여 나눕니다.
+    /// - 본문의 `#N`(attribute group)과 `!N`(metadata)은 모듈 전체에서 매긴
+    ///   번호이고 그 내용은 마지막 함수 뒤에 출력됩니다. 번호 대신 참조하는
+    ///   내용을 해시에 넣으므로, TBAA 등 함수가 참조하는 metadata가 바뀌면
+    ///   그 함수의 키가 바뀌고, 번호만 바뀌면 키가 바뀌지 않습니다.
+    static DenseMap<const Function *, uint64_t> hashFunctions(Module &M)
+    {
+      struct FunctionOffsetWriter : public AssemblyAnnotationWriter
+      {
+        SmallVector<std::pair<const Function *, size_t>, 0> offsets;
+
+        void emitFunctionAnnot(const Function *F, formatted_raw_ostream &OS) override
+        {
+          offsets.push_back(std::make_pair(F, OS.tell()));
         }
+      };
+
+      std::string text;
+      raw_string_ostream os(text);
+      FunctionOffsetWriter writer;
+      M.print(os, &writer);
+      os.flush();
+
+      // 마지막 함수 뒤의 attribute group과 metadata는 어느 함수에도 넣지
+      // 않습니다.
+      size_t tail = text.size();
+      if (!writer.offsets.empty())
+        for (StringRef marker : { "\nattributes #", "\n!" })
+          tail = std::min(tail, StringRef(text).find(marker, writer.offsets.back().second));
+      SlotContents contents(StringRef(text).substr(tail));
+
+      DenseMap<const Function *, uint64_t> hashes;
+      for (size_t i = 0; i < writer.offsets.size(); i++)
+      {
+        const Function *function = writer.offsets[i].first;
+        size_t begin = writer.offsets[i].second;
+        size_t end = i + 1 < writer.offsets.size() ? writer.offsets[i + 1].second : tail;
+
+        std::string body;
+        raw_string_ostream bs(body);
+        bs << "IDC" << SummaryVersion << IDCEmptyFunctionAffectsReturn
+          << IDCScanControlFlow << IDCMemorySSA << function->getName() << "\n";
+        contents.write(StringRef(text).slice(begin, end), bs);
+        bs.flush();
+        hashes[function] = xxHash64(body);
+      }
+      return hashes;
+    }
+
+    static uint64_t hashValues(ArrayRef<uint64_t> Values)
+    {
+      return xxHash64(StringRef(reinterpret_cast<const char *>(Values.data()),
+        Values.size() * sizeof(uint64_t)));
+    }
+
+    bool load(FunctionDependency *FD, uint64_t Key)
+    {
+      ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(getPath(Key));
+      if (!buffer)
+        return false;
 
-        function_dependency->addFunctionDependency(depends);
+      size_t argc = FD->getFunction()->arg_size();
+      SmallVector<StringRef, 8> lines;
+      (*buffer)->getBuffer().split(lines, '\n', -1, false);
 
-        return depends;
+      if (lines.size() != argc + 3 || lines[0] != getHeader() ||
+          lines[1] != ("args " + Twine(argc)).str())
+        return false;
+
+      // 모든 줄을 검사한 뒤에 요약정보를 설정합니다.
+      SmallVector<StringRef, 8> bits;
+      for (size_t i = 0; i <= argc; i++)
+      {
+        StringRef line = lines[i + 2];
+        std::string prefix = i == 0 ? "ret " : ("arg " + Twine(i - 1) + " ").str();
+        if (!line.consume_front(prefix) || line.size() != argc ||
+            line.find_first_not_of("01") != StringRef::npos)
+          return false;
+        bits.push_back(line);
       }
-      
-      void processBlock(Argument *A, BlockNode *BN)
+
+      for (size_t j = 0; j < argc; j++)
+        if (bits[0][j] == '1')
+          FD->setReturnDependency(j);
+      for (size_t i = 0; i < argc; i++)
+        for (size_t j = 0; j < argc; j++)
+          if (bits[i + 1][j] == '1')
+            FD->setArgumentDependency(i, j);
+      return true;
+    }
+
+    void store(FunctionDependency *FD, uint64_t Key)
+    {
+      std::string text;
+      raw_string_ostream os(text);
+      size_t argc = FD->getFunction()->arg_size();
+
+      os << getHeader() << "\n" << "args " << argc << "\n" << "ret ";
+      for (size_t j = 0; j < argc; j++)
+        os << (FD->hasReturnDependency(j) ? '1' : '0');
+      os << "\n";
+      for (size_t i = 0; i < argc; i++)
+      {
+        os << "arg " << i << " ";
+        for (size_t j = 0; j < argc; j++)
+          os << (FD->hasArgumentDependency(i, j) ? '1' : '0');
+        os << "\n";
+      }
+      os.flush();
+
+      std::string path = getPath(Key);
+      SmallString<128> temp;
+      int fd;
+      if (sys::fs::createUniqueFile(path + ".tmp%%%%%%", fd, temp))
+        return;
+      {
+        raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << text;
+      }
+      if (sys::fs::rename(temp, path))
+        sys::fs::remove(temp);
+    }
+
+  private:
+
+    /// [정보]
+    /// 모듈 출력의 `#N`과 `!N`을 번호 대신 가리키는 내용으로 바꿔 씁니다.
+    ///
+    /// [보충]
+    /// - attribute group은 내용을 그대로, metadata는 내용을 같은 방식으로
+    ///   바꿔 쓴 것의 해시를 씁니다. 해시는 slot마다 한 번만 계산합니다.
+    /// - 순환하는 metadata(loop metadata, debug info 등)는 이미 바꿔 쓰는 중인
+    ///   node를 만나면 몇 단계 위의 node인지를 씁니다. 이 경우 해시가 바깥
+    ///   node에 따라 달라지므로, 바깥 node를 가리키는 node의 해시는 저장하지
+    ///   않습니다.
+    /// - 따옴표 안의 문자열은 바꾸지 않습니다.
+    class SlotContents
+    {
+      DenseMap<unsigned, StringRef> attributes;
+      DenseMap<unsigned, StringRef> metadata;
+      DenseMap<unsigned, uint64_t> metadata_hashes;
+      SmallVector<unsigned, 16> stack;
+
+    public:
+
+      SlotContents(StringRef Tail)
+      {
+        SmallVector<StringRef, 0> lines;
+        Tail.split(lines, '\n', -1, false);
+        for (StringRef line : lines) {
+          DenseMap<unsigned, StringRef> *slots = &metadata;
+          if (line.consume_front("attributes #"))
+            slots = &attributes;
+          else if (!line.consume_front("!"))
+            continue;
+          unsigned slot;
+          StringRef number = line.take_while(isDigit);
+          line = line.drop_front(number.size());
+          if (!number.getAsInteger(10, slot) && line.consume_front(" = "))
+            (*slots)[slot] = line;
+        }
+      }
+
+      void write(StringRef Text, raw_ostream &OS)
+      {
+        size_t reached = 0;
+        write(Text, OS, reached);
+      }
+
+    private:
+
+      /// Reached는 Text가 가리킨 stack의 node 중 가장 아래 것의 위치입니다.
+      void write(StringRef Text, raw_ostream &OS, size_t &Reached)
       {
-        bool is_perpect = BN->getFromNodes().size() == 1;
-        for (BlockNode *bn : BN->getFromNodes())
+        for (size_t i = 0; i < Text.size(); )
         {
-          for (BlockNode *x : block_nodes)
-            if (x == bn) return;
-          block_nodes.push_back(bn);
-          if (bn->getBranchInst()->isConditional()) {
-            runChecker(A, bn->getBranchInst()->getCondition(), is_perpect);
+          char c = Text[i];
+          if (c == '"') {
+            size_t close = Text.find('"', i + 1);
+            close = close == StringRef::npos ? Text.size() : close + 1;
+            OS << Text.slice(i, close);
+            i = close;
+            continue;
+          }
+
+          size_t end = i + 1;
+          while (end < Text.size() && isDigit(Text[end]))
+            end++;
+          unsigned slot;
+          if ((c != '#' && c != '!') || end == i + 1 ||
+              Text.slice(i + 1, end).getAsInteger(10, slot)) {
+            OS << c;
+            i++;
+            continue;
           }
-          processBlock(A, bn);
+
+          if (c == '#')
+            OS << "#{" << attributes.lookup(slot) << "}";
+          else
+            writeMetadata(slot, OS, Reached);
+          i = end;
         }
       }
 
-      /// [정보]
-      /// 검사하려는 함수인자 A와 같은 V가 있는지 재귀적으로 검사합니다.
-      /// 이 함수는 runBottomUp과 runSearch를 합한 형태를 가집니다.
-      ///
-      /// [보충]
-      /// 
-      void runChecker(Argument *A, Value *V, bool P = true)
+      void writeMetadata(unsigned Slot, raw_ostream &OS, size_t &Reached)
       {
-        if (Argument *arg = dyn_cast<Argument> (V)) {
-          function_dependency->getFunctionArgumentDependency(
-            A->getArgNo())->setArgumentDependency(arg->getArgNo());
+        auto cached = metadata_hashes.find(Slot);
+        if (cached != metadata_hashes.end()) {
+          OS << '!' << format_hex_no_prefix(cached->second, 16);
           return;
         }
-        
-#if IDC_PRINT_INSTRUCTION
-          errs() << "    (" << function->getName() << ")" << *V << "\n";
-#endif
 
-        // 이 함수는 무한재귀 성질을 가지므로 중복검사를 시행합니다.
-        if (std::find(overlap.begin(), overlap.end(), V) != overlap.end())
+        auto on_stack = std::find(stack.begin(), stack.end(), Slot);
+        if (on_stack != stack.end()) {
+          size_t depth = on_stack - stack.begin();
+          Reached = std::min(Reached, depth);
+          OS << "!^" << stack.size() - depth;
           return;
-        overlap.push_back(V);
-        
-        // runSearch 알고리즘
-        for (BasicBlock& basic_block : *function)
-          for (Instruction& inst : basic_block) {
-            if (StoreInst *si = dyn_cast<StoreInst> (&inst))
-            {
-              if (si->getPointerOperand() == V)
-                runChecker(A, si->getValueOperand(), P);
-              else if (si->getValueOperand() == V)
-                runChecker(A, si->getPointerOperand(), P);
-            }
-            else if (LoadInst *li = dyn_cast<LoadInst> (&inst))
-            {
-              if (si->getPointerOperand() == V)
-                runChecker(A, li, P);
-            }
-            else if (CallInst *ci = dyn_cast<CallInst> (&inst))
-            {
-              FunctionDependency *depends;
-              if (!(depends = processCallInst(ci))) continue;
-              for (size_t i = 0; i < depends->getFunction()->arg_size(); i++)
-                if (depends->getFunctionArgumentDependency(i)->getArgument() == V)
-                  for (size_t j = 0; j < depends->getFunction()->arg_size(); j++)
-                    if (depends->getFunctionArgumentDependency(i)->hasArgumentDependency(j))
-                      runChecker(A, depends->getFunctionArgumentDependency(j)->getArgument(), P);
-            }
-          }
-        
-        // runBottomUp 알고리즘
-        if (Instruction *inst = dyn_cast <Instruction> (V))
-        {
-#if IDC_SCAN_CONTROL_FLOW
-          BranchManager *bm = function_dependency->getBranchManager();
-          BlockNode *this_node = bm->getNodeFromInstruction(inst);
-          processBlock(A, this_node);
-#endif
-
-          if (PHINode *phi = dyn_cast<PHINode> (inst)) {
-            for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
-              Value *target_value = phi->getIncomingValue(i);
-              runChecker(A, target_value, P);
-            }
-          } else if (CallInst *ci = dyn_cast<CallInst> (inst)) {
-            FunctionDependency *depends;
-            if (!(depends = processCallInst(ci))) return;
-            for (size_t i = 0; i < ci->getCalledFunction()->arg_size(); i++)
-              if (depends->hasReturnDependency(i) == true) {
-                runChecker(A, ci->getOperand(i), P);
-              }
-          } else {
-            for (unsigned i = 0; i < inst->getNumOperands(); i++) {
-              Value *target_value = inst->getOperand(i);
-              runChecker(A, target_value, P);
-            }
-          }
         }
-      }
 
+        size_t depth = stack.size(), reached = depth;
+        std::string body;
+        raw_string_ostream bs(body);
+        stack.push_back(Slot);
+        write(metadata.lookup(Slot), bs, reached);
+        stack.pop_back();
+        bs.flush();
+
+        uint64_t hash = xxHash64(body);
+        if (reached >= depth)
+          metadata_hashes[Slot] = hash;
+        else
+          Reached = std::min(Reached, reached);
+        OS << '!' << format_hex_no_prefix(hash, 16);
+      }
     };
 
+    static std::string getHeader()
+    {
+      return ("IDCSUMMARY " + Twine(SummaryVersion)).str();
+    }
+
+    std::string getPath(uint64_t Key)
+    {
+      SmallString<128> path(directory);
+      sys::path::append(path, utohexstr(Key, /*LowerCase=*/true) + ".idc");
+      return std::string(path.str());
+    }
   };
-  
-  /// This class must be called only once by each target-function.
-  class BottomUpDependencyChecker
+
+  /// [정보]
+  /// 이전 분석의 요약정보와 slice를 파일에 기록해 두고, 다음 분석에서
+  /// 영향을 받지 않은 함수의 결과를 다시 계산하지 않고 사용합니다.
+  ///
+  /// [보충]
+  /// - 함수마다 본문의 해시, 요약정보, 요약정보를 계산할 때 사용한 피호출
+  ///   함수들(call_dependency), 그리고 slice와 slice를 계산할 때 사용한 피호출
+  ///   함수들을 기록합니다. 함수는 이름으로 찾습니다.
+  /// - 본문이 같고 기록된 피호출 함수들의 요약정보가 모두 이전과 같다면 기록된
+  ///   결과를 그대로 사용합니다. 다시 계산한 요약정보가 이전과 같다면 호출하는
+  ///   함수들은 영향을 받지 않습니다. (early cutoff)
+  /// - 해시는 분석을 시작할 때 미리 계산합니다. 분석 결과를 metadata로 표시한
+  ///   뒤에 저장하더라도 같은 입력에 대한 해시가 기록됩니다.
+  /// - 파일을 읽을 수 없거나 형식이 맞지 않으면 모든 함수를 다시 계산합니다.
+  class IncrementalState
   {
-    Function *function;
-    DependencyMap *dependency_map;
-    FunctionDependency *function_dependency;
-    InstructionDependency *inst_dependency;
-    std::vector<BlockNode *> block_nodes;
+    static constexpr unsigned StateVersion = 2;
+
+    struct Record
+    {
+      uint64_t hash = 0;
+      SmallVector<std::string, 4> summary;
+      SmallVector<Function *, 4> callees;
+      bool has_slices = false;
+      SmallVector<Function *, 4> slice_callees;
+      std::vector<std::pair<BitVector, BitVector>> slices;
+    };
+
+    std::string path;
+    std::string loaded;
+    DenseMap<const Function *, uint64_t> hashes;
+    DenseMap<const Function *, Record> records;
 
   public:
 
-    BottomUpDependencyChecker(Function *F, SmallVector<Value *, 16> V,
-      DependencyMap *DM, FunctionDependency *FD, InstructionDependencyMap *IDM)
-      : function(F), dependency_map(DM), function_dependency(FD)
+    IncrementalState(StringRef Path, Module &M) : path(Path.str())
     {
-      for (Value *value : V)
+      hashes = SummaryCache::hashFunctions(M);
+
+      ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(path);
+      if (!buffer)
+        return;
+      loaded = (*buffer)->getBuffer().str();
+      if (!parse(loaded, M))
+        records.clear();
+    }
+
+    /// [정보]
+    /// SCC 구성원들의 요약정보와 call_dependency를 기록에서 불러옵니다.
+    /// 불러오지 못한 경우 false를 반환하며, 아무것도 바꾸지 않습니다.
+    ///
+    /// [보충]
+    /// 구성원들의 본문이 모두 같고, SCC 밖의 기록된 피호출 함수들의 요약정보가
+    /// 모두 이전과 같을 때만 불러옵니다.
+    bool loadSummaries(ArrayRef<FunctionDependency *> Members, DependencyMap *DM)
+    {
+      for (FunctionDependency *fd : Members)
+      {
+        const Record *record = getRecord(fd->getFunction());
+        if (!record || record->summary.size() != fd->getFunction()->arg_size() + 1 ||
+            !areUnchanged(record->callees, DM, Members))
+          return false;
+      }
+
+      for (FunctionDependency *fd : Members)
       {
-        inst_dependency = new InstructionDependency();
-        runSearch(value, true, true);
-        IDM->addDependency(value, inst_dependency);
-        inst_dependency = nullptr;
+        const Record *record = getRecord(fd->getFunction());
+        size_t argc = fd->getFunction()->arg_size();
+        for (size_t j = 0; j < argc; j++)
+          if (record->summary[0][j] == '1')
+            fd->setReturnDependency(j);
+        for (size_t i = 0; i < argc; i++)
+          for (size_t j = 0; j < argc; j++)
+            if (record->summary[i + 1][j] == '1')
+              fd->setArgumentDependency(i, j);
+        for (Function *callee : record->callees)
+          fd->addFunctionDependency(DM->getDependency(callee));
+        fd->setSummaryChanged(false);
       }
+      return true;
     }
 
-  private:
+    /// 계산한 요약정보를 기록과 비교하여 달라졌는지 표시합니다.
+    void updateSummaries(ArrayRef<FunctionDependency *> Members)
+    {
+      for (FunctionDependency *fd : Members)
+      {
+        auto it = records.find(fd->getFunction());
+        fd->setSummaryChanged(it == records.end() ||
+          it->second.summary != formatSummary(fd));
+      }
+    }
 
-    void runBottomUp(Value *V, bool P = true)
+    /// [정보]
+    /// 대상 함수의 annotated variable별 slice를 기록에서 불러와 IDM에 넣습니다.
+    /// 불러오지 못한 경우 false를 반환하며, 아무것도 바꾸지 않습니다.
+    ///
+    /// [보충]
+    /// slice는 BottomUpDependencyChecker와 같이 중복을 제거한 annotated variable의
+    /// 순서대로 기록되어 있습니다.
+    bool loadSlices(FunctionDependency *FD, ArrayRef<Value *> Values, DependencyMap *DM,
+      InstructionDependencyMap *IDM)
     {
-      if (Instruction *inst = dyn_cast <Instruction> (V))
+      const Record *record = getRecord(FD->getFunction());
+      if (!record || !record->has_slices || !areUnchanged(record->slice_callees, DM, None))
+        return false;
+
+      SmallVector<Value *, 16> values;
+      for (Value *value : Values)
+        if (!is_contained(values, value))
+          values.push_back(value);
+      if (values.size() != record->slices.size())
+        return false;
+
+      const InstructionNumbering *numbering = FD->getInstructionNumbering();
+      for (auto& slice : record->slices)
+        if (slice.first.find_last() >= (int)numbering->size() ||
+            slice.second.find_last() >= (int)numbering->size())
+          return false;
+
+      for (Function *callee : record->slice_callees)
+        FD->addFunctionDependency(DM->getDependency(callee));
+      for (size_t i = 0; i < values.size(); i++)
       {
-        if (inst_dependency->hasInstructoin(inst, P))
-          return;
-        
-#if IDC_PRINT_INSTRUCTION
-          errs() << "    (" << function->getName() << ")" << *inst << "\n";
-#endif
-
-        inst_dependency->addInstruction(inst, P);
-
-        if (PHINode *phi = dyn_cast<PHINode> (inst)) {
-          for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
-            Value *target_value = phi->getIncomingValue(i);
-            runBottomUp(target_value, P);
-            runSearch(target_value, P);
-          }
-        } else if (CallInst *ci = dyn_cast<CallInst> (inst)) {
-          FunctionDependency *depends = processCallInst(ci);
-          for (size_t i = 0; i < ci->getCalledFunction()->arg_size(); i++)
-            if (depends->hasReturnDependency(i) == true) {
-              runBottomUp(ci->getOperand(i), P);
-              runSearch(ci->getOperand(i), P);
-            }
-        } else {
-          for (unsigned i = 0; i < inst->getNumOperands(); i++) {
-            Value *target_value = inst->getOperand(i);
-            runBottomUp(target_value, P);
-            runSearch(target_value, P);
-          }
+        BitVector perpect = record->slices[i].first;
+        BitVector maybe = record->slices[i].second;
+        perpect.resize(numbering->size());
+        maybe.resize(numbering->size());
+        IDM->createDependency(values[i], numbering)->merge(perpect, maybe);
+      }
+      return true;
+    }
+
+    /// 모듈의 요약정보와 검사한 함수들의 slice를 기록합니다. 기록이 이전과
+    /// 같으면 파일을 다시 쓰지 않습니다.
+    void save(Module &M, DependencyMap *DM, DependencyMap *AnnotatedMap)
+    {
+      std::string text;
+      raw_string_ostream os(text);
+      os << getHeader() << "\n";
+
+      for (Function& function : M)
+      {
+        FunctionDependency *fd = DM->getDependency(&function);
+        if (!fd || !function.hasName())
+          continue;
+
+        os << "function " << utohexstr(hashes.lookup(&function), /*LowerCase=*/true)
+          << " " << function.getName() << "\n";
+        SmallVector<std::string, 4> summary = formatSummary(fd);
+        for (size_t i = 0; i < summary.size(); i++)
+        {
+          if (i == 0)
+            os << "ret ";
+          else
+            os << "arg " << i - 1 << " ";
+          os << summary[i] << "\n";
+        }
+        for (size_t i = 0; i < fd->getFunctionDependencyNum(); i++)
+          os << "call " << fd->getFunctionDependency(i)->getFunction()->getName() << "\n";
+
+        FunctionDependency *slices = AnnotatedMap->getDependency(&function);
+        if (!slices || !slices->getInstrctionDependencyMap())
+          continue;
+
+        os << "slices\n";
+        for (size_t i = 0; i < slices->getFunctionDependencyNum(); i++)
+          os << "slicecall " << slices->getFunctionDependency(i)->getFunction()->getName() << "\n";
+        for (auto& element : *slices->getInstrctionDependencyMap())
+        {
+          os << "slice ";
+          writeBits(os, element.second->getPerpectBits());
+          os << " ";
+          writeBits(os, element.second->getMaybeBits());
+          os << "\n";
         }
-        processBranches(V);
       }
+      os.flush();
+      if (text == loaded)
+        return;
+
+      SmallString<128> temp;
+      int fd;
+      if (sys::fs::createUniqueFile(path + ".tmp%%%%%%", fd, temp))
+        return;
+      {
+        raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << text;
+      }
+      if (sys::fs::rename(temp, path))
+        sys::fs::remove(temp);
+    }
+
+  private:
+
+    static std::string getHeader()
+    {
+      return ("IDCSTATE " + Twine(StateVersion)).str();
+    }
+
+    /// 본문이 기록과 같은 함수의 기록을 가져옵니다.
+    const Record *getRecord(Function *F) const
+    {
+      auto it = records.find(F);
+      if (it == records.end() || it->second.hash != hashes.lookup(F))
+        return nullptr;
+      return &it->second;
+    }
+
+    /// 기록된 피호출 함수들(Members 제외)의 요약정보가 모두 이전과 같은지
+    /// 확인합니다. 이름으로 찾지 못한 함수가 있으면 false입니다.
+    /// intrinsic의 요약정보는 항상 비어 있으므로 확인하지 않습니다. (CallGraph가
+    /// intrinsic을 호출하는 함수보다 늦게 방문할 수 있습니다.)
+    static bool areUnchanged(ArrayRef<Function *> Callees, DependencyMap *DM,
+      ArrayRef<FunctionDependency *> Members)
+    {
+      for (Function *callee : Callees)
+      {
+        if (callee && callee->isIntrinsic())
+          continue;
+        FunctionDependency *depends = callee ? DM->getDependency(callee) : nullptr;
+        if (!depends)
+          return false;
+        if (depends->isSummaryChanged() && !is_contained(Members, depends))
+          return false;
+      }
+      return true;
+    }
+
+    /// 반환값 행부터 각 함수인자 행까지 요약정보를 "01" 문자열로 나타냅니다.
+    static SmallVector<std::string, 4> formatSummary(FunctionDependency *FD)
+    {
+      size_t argc = FD->getFunction()->arg_size();
+      SmallVector<std::string, 4> rows;
+      for (size_t i = 0; i <= argc; i++)
+      {
+        std::string row;
+        for (size_t j = 0; j < argc; j++)
+          row += (i == 0 ? FD->hasReturnDependency(j) : FD->hasArgumentDependency(i - 1, j)) ? '1' : '0';
+        rows.push_back(row);
+      }
+      return rows;
+    }
+
+    /// slice는 Perpect와 Maybe인 Instruction 번호의 bitmap으로 기록합니다.
+    /// 16진수 한 자리가 번호 4개를 나타내며, 낮은 번호가 앞에 옵니다.
+    static void writeBits(raw_ostream &OS, const BitVector& Bits)
+    {
+      int last = Bits.find_last();
+      for (int i = 0; i <= last / 4; i++)
+      {
+        unsigned digit = 0;
+        for (int j = 0; j < 4 && i * 4 + j <= last; j++)
+          if (Bits.test(i * 4 + j))
+            digit |= 1 << j;
+        OS << hexdigit(digit, /*LowerCase=*/true);
+      }
+      if (last < 0)
+        OS << "0";
+    }
+
+    static bool readBits(StringRef Text, BitVector& Bits)
+    {
+      Bits.resize(Text.size() * 4);
+      for (size_t i = 0; i < Text.size(); i++)
+      {
+        unsigned digit = hexDigitValue(Text[i]);
+        if (digit == -1U)
+          return false;
+        for (unsigned j = 0; j < 4; j++)
+          if (digit & (1 << j))
+            Bits.set(i * 4 + j);
+      }
+      return !Text.empty();
+    }
+
+    bool parse(StringRef Buffer, Module &M)
+    {
+      SmallVector<StringRef, 64> lines;
+      Buffer.split(lines, '\n', -1, false);
+      if (lines.empty() || lines[0] != getHeader())
+        return false;
+
+      // 모듈에 없는 함수의 기록은 읽기만 하고 버립니다.
+      Record discarded;
+      Record *record = nullptr;
+
+      for (size_t i = 1; i < lines.size(); i++)
+      {
+        StringRef line = lines[i];
+
+        if (line.consume_front("function ")) {
+          std::pair<StringRef, StringRef> fields = line.split(' ');
+          uint64_t hash;
+          if (fields.first.getAsInteger(16, hash))
+            return false;
+          Function *function = M.getFunction(fields.second);
+          record = function ? &records[function] : &discarded;
+          *record = Record();
+          record->hash = hash;
+          continue;
+        }
+
+        if (!record)
+          return false;
+
+        if (line.consume_front("ret ")) {
+          if (!record->summary.empty())
+            return false;
+          record->summary.push_back(line.str());
+        } else if (line.consume_front("arg ")) {
+          std::pair<StringRef, StringRef> fields = line.split(' ');
+          size_t index;
+          if (fields.first.getAsInteger(10, index) || index + 1 != record->summary.size())
+            return false;
+          record->summary.push_back(fields.second.str());
+        } else if (line.consume_front("call ")) {
+          record->callees.push_back(M.getFunction(line));
+        } else if (line == "slices") {
+          record->has_slices = true;
+        } else if (line.consume_front("slicecall ")) {
+          record->slice_callees.push_back(M.getFunction(line));
+        } else if (line.consume_front("slice ")) {
+          std::pair<StringRef, StringRef> fields = line.split(' ');
+          record->slices.emplace_back();
+          if (!readBits(fields.first, record->slices.back().first) ||
+              !readBits(fields.second, record->slices.back().second))
+            return false;
+        } else {
+          return false;
+        }
+      }
+
+      // 요약정보의 행들은 모두 함수인자 수와 같은 길이의 "01" 문자열이어야 합니다.
+      for (auto& element : records)
+        for (const std::string& row : element.second.summary)
+          if (row.size() != element.first->arg_size() ||
+              StringRef(row).find_first_not_of("01") != StringRef::npos)
+            return false;
+      return true;
+    }
+  };
+
+  /// [정보]
+  /// CallGraph의 SCC들을 post-order(피호출 함수 먼저)로 방문하여 모든 함수의
+  /// FunctionDependency를 한 번씩 계산합니다.
+  ///
+  /// [보충]
+  /// - 어떤 SCC를 계산할 때 그 SCC가 호출하는 다른 SCC들의 요약정보는 이미
+  ///   완성되어 있으므로, processCallInst가 피호출 함수를 그 자리에서 분석하는
+  ///   일이 없습니다.
+  /// - 재귀호출로 이루어진 SCC는 recursion_map으로 호출을 끊는 대신, 구성원들의
+  ///   요약정보가 더 이상 변하지 않을 때까지 반복하여 계산합니다.
+  /// - 스레드를 둘 이상 사용하는 경우, 호출하는 SCC들이 모두 끝난 SCC부터
+  ///   ThreadPool에서 계산합니다. 각 SCC는 자기 구성원의 요약정보만 쓰고 이미
+  ///   완성된 요약정보만 읽으므로 결과는 한 스레드에서 계산한 것과 같습니다.
+  /// - IncrementalState가 주어지면 영향을 받지 않은 SCC의 요약정보를 기록에서
+  ///   불러오고, 계산한 SCC는 요약정보가 이전과 달라졌는지 표시합니다.
+  class CallGraphDependencyChecker
+  {
+    struct SCCNode
+    {
+      SmallVector<FunctionDependency *, 4> members;
+      SmallVector<unsigned, 4> callees;
+      SmallVector<uint64_t, 4> keys;
+      uint64_t hash;
+      bool has_cycle;
+    };
+
+  public:
+
+    static void run(CallGraph &CG, DependencyMap *DM, unsigned Threads = 1,
+      SummaryCache *Cache = nullptr, IncrementalState *State = nullptr)
+    {
+      // 작업 스레드들이 DependencyMap을 읽기만 하도록 모든 함수의
+      // FunctionDependency를 미리 만들어 둡니다.
+      for (Function& function : CG.getModule())
+        if (!DM->hasDependency(&function))
+          DM->addDependency(&function, DM->createDependency(&function));
+
+      std::vector<SCCNode> sccs;
+      DenseMap<Function *, unsigned> scc_index;
+      DenseMap<const Function *, uint64_t> hashes;
+      if (Cache)
+        hashes = SummaryCache::hashFunctions(CG.getModule());
+
+      for (scc_iterator<CallGraph *> scc = scc_begin(&CG); !scc.isAtEnd(); ++scc)
+      {
+        unsigned index = sccs.size();
+        SCCNode node;
+        node.has_cycle = scc.hasCycle();
+
+        for (CallGraphNode *cgn : *scc)
+          if (Function *function = cgn->getFunction()) {
+            node.members.push_back(DM->getDependency(function));
+            scc_index[function] = index;
+          }
+
+        // post-order이므로 피호출 SCC들은 이미 번호를 가지고 있습니다.
+        for (CallGraphNode *cgn : *scc)
+          for (auto& record : *cgn)
+            if (Function *callee = record.second->getFunction()) {
+              auto it = scc_index.find(callee);
+              if (it != scc_index.end() && it->second != index &&
+                  !is_contained(node.callees, it->second))
+                node.callees.push_back(it->second);
+            }
+
+        if (Cache)
+          hashSCC(node, sccs, hashes);
+
+        sccs.push_back(std::move(node));
+      }
+
+      if (Threads <= 1) {
+        for (SCCNode& node : sccs)
+          runIncrementalSCC(node, DM, Cache, State);
+        return;
+      }
+
+      runParallel(sccs, DM, Threads, Cache, State);
+    }
+
+  private:
+
+    /// SCC의 해시와 구성원들의 캐시 키를 계산합니다. 피호출 SCC들의 해시는
+    /// 이미 계산되어 있습니다.
+    static void hashSCC(SCCNode& Node, ArrayRef<SCCNode> SCCs,
+      const DenseMap<const Function *, uint64_t>& Hashes)
+    {
+      SmallVector<uint64_t, 8> own;
+      for (FunctionDependency *fd : Node.members)
+        own.push_back(Hashes.lookup(fd->getFunction()));
+
+      SmallVector<uint64_t, 8> values(own.begin(), own.end());
+      llvm::sort(values);
+      SmallVector<uint64_t, 8> callees;
+      for (unsigned callee : Node.callees)
+        callees.push_back(SCCs[callee].hash);
+      llvm::sort(callees);
+      values.append(callees.begin(), callees.end());
+      Node.hash = SummaryCache::hashValues(values);
+
+      for (uint64_t hash : own)
+        Node.keys.push_back(SummaryCache::hashValues({ Node.hash, hash }));
+    }
+
+    /// 영향을 받지 않은 SCC라면 요약정보를 기록에서 불러오고, 그렇지 않으면
+    /// 계산한 뒤 이전과 달라졌는지 표시합니다.
+    static void runIncrementalSCC(SCCNode& Node, DependencyMap *DM, SummaryCache *Cache,
+      IncrementalState *State)
+    {
+      if (State && State->loadSummaries(Node.members, DM)) {
+        NumIncrementalSummaries += Node.members.size();
+        return;
+      }
+
+      runCachedSCC(Node, DM, Cache);
+      if (State)
+        State->updateSummaries(Node.members);
+    }
+
+    /// 캐시에 SCC의 모든 구성원의 요약정보가 있으면 불러오고, 그렇지 않으면
+    /// 계산하여 저장합니다.
+    static void runCachedSCC(SCCNode& Node, DependencyMap *DM, SummaryCache *Cache)
+    {
+      if (!Cache) {
+        runSCC(Node.members, DM, Node.has_cycle);
+        return;
+      }
+
+      bool hit = true;
+      for (size_t i = 0; i < Node.members.size() && hit; i++)
+        hit = Cache->load(Node.members[i], Node.keys[i]);
+
+      if (hit) {
+        for (FunctionDependency *fd : Node.members)
+          recordCallees(fd, DM);
+        NumSummaryCacheHits += Node.members.size();
+        return;
+      }
+
+      runSCC(Node.members, DM, Node.has_cycle);
+      for (size_t i = 0; i < Node.members.size(); i++)
+        Cache->store(Node.members[i], Node.keys[i]);
+      NumSummaryCacheMisses += Node.members.size();
+    }
+
+    static void runSCC(ArrayRef<FunctionDependency *> Members, DependencyMap *DM, bool HasCycle)
+    {
+      bool changed;
+      do {
+        changed = false;
+        for (FunctionDependency *fd : Members)
+        {
+          size_t before = fd->countDependencies();
+          DependencyChecker::run(fd, DM);
+          if (fd->countDependencies() != before)
+            changed = true;
+        }
+      } while (changed && HasCycle);
+
+      for (FunctionDependency *fd : Members)
+        fd->releaseWalk();
+    }
+
+    /// 캐시에서 불러온 요약정보에는 call_dependency가 없으므로, 본문에서 직접
+    /// 호출하는 모든 함수를 call_dependency로 기록합니다. 계산했을 때의
+    /// call_dependency를 포함합니다.
+    static void recordCallees(FunctionDependency *FD, DependencyMap *DM)
+    {
+      for (BasicBlock& basic_block : *FD->getFunction())
+        for (Instruction& inst : basic_block)
+          if (CallInst *ci = dyn_cast<CallInst> (&inst))
+            if (Function *callee = ci->getCalledFunction())
+              if (FunctionDependency *depends = DM->getDependency(callee))
+                FD->addFunctionDependency(depends);
+    }
+
+    /// 피호출 SCC들이 모두 끝난 SCC를 ThreadPool에 넣습니다. 하나의 SCC가
+    /// 끝날 때마다 그 SCC를 호출하는 SCC들의 남은 피호출 SCC 수를 줄입니다.
+    static void runParallel(std::vector<SCCNode>& SCCs, DependencyMap *DM, unsigned Threads,
+      SummaryCache *Cache, IncrementalState *State)
+    {
+      std::vector<std::atomic<unsigned>> pending(SCCs.size());
+      std::vector<SmallVector<unsigned, 4>> callers(SCCs.size());
+
+      for (unsigned i = 0; i < SCCs.size(); i++) {
+        pending[i] = SCCs[i].callees.size();
+        for (unsigned callee : SCCs[i].callees)
+          callers[callee].push_back(i);
+      }
+
+      ThreadPool pool(hardware_concurrency(Threads));
+      std::function<void(unsigned)> schedule = [&](unsigned Index) {
+        pool.async([&, Index] {
+          runIncrementalSCC(SCCs[Index], DM, Cache, State);
+          for (unsigned caller : callers[Index])
+            if (--pending[caller] == 0)
+              schedule(caller);
+        });
+      };
+
+      // 작업이 시작되면 pending이 바뀌므로, 처음 시작할 SCC들을 먼저 모읍니다.
+      SmallVector<unsigned, 16> leaves;
+      for (unsigned i = 0; i < SCCs.size(); i++)
+        if (SCCs[i].callees.empty())
+          leaves.push_back(i);
+      for (unsigned leaf : leaves)
+        schedule(leaf);
+
+      pool.wait();
+    }
+
+  };
+
+  class SliceBuilder;
+
+  /// [정보]
+  /// slice의 한 조각을 만드는 탐색입니다. annotated variable에서 시작하는
+  /// 탐색이거나, 포인터 V에 대한 Search(V, P)의 전이적 폐포(fragment)를
+  /// 만드는 탐색입니다.
+  ///
+  /// [보충]
+  /// 다른 포인터에 대한 Search를 만나면 SliceBuilder에게 그 fragment를
+  /// 물어봅니다. 아직 없는 fragment라면 탐색을 멈추고 SliceBuilder가 그
+  /// fragment를 먼저 만들게 합니다.
+  class SliceWalker
+    : public DependencyWalker<SliceWalker>
+  {
+    friend class DependencyWalker<SliceWalker>;
+    friend class SliceBuilder;
+
+    struct Fragment;
+
+    SliceBuilder *builder;
+    Fragment *fragment;
+    SmallPtrSet<Fragment *, 8> merged;
+
+  public:
+
+    SliceWalker(FunctionDependency *FD, DependencyMap *DM, SliceBuilder *Builder,
+      Fragment *F, InstructionDependency *Slice, Value *V, bool P, bool ROOT)
+      : DependencyWalker(FD, DM), builder(Builder), fragment(F)
+    {
+      inst_dependency = Slice;
+      startWalk();
+      pushSearch(V, P, ROOT);
+    }
+
+  private:
+
+    SearchAction resolveSearch(Value *V, bool P, bool ROOT);
+    bool shouldPause();
+
+    void followStore(StoreInst *SI, bool P, bool ROOT)
+    {
+      pushOperand(SI->getValueOperand(), P && ROOT);
+    }
+
+    void followCallArgument(Value *V, bool P, bool ROOT)
+    {
+      pushOperand(V, P && ROOT);
+    }
+    
+  };
+
+  /// [정보]
+  /// annotated variable들에 대한 Dependency(slice)를 만듭니다.
+  ///
+  /// [보충]
+  /// - 메모리를 거쳐 전달되는 값을 찾는 Search(V, P)는 V가 포인터라면 어떤
+  ///   annotated variable에서 시작했는지와 관계없이 같은 Instruction들을
+  ///   모읍니다. 따라서 그 결과(fragment)를 한 번만 만들어 두고, 이후의
+  ///   slice들은 fragment를 merge하여 재사용합니다. 여러 annotated variable이
+  ///   같은 반복문의 유도변수를 거치는 경우 그 부분을 다시 탐색하지 않습니다.
+  /// - fragment를 만드는 중에 또 다른 fragment가 필요하면, 지금의 탐색을
+  ///   멈춘 채 스택에 쌓고 그 fragment부터 만듭니다. (재귀호출 없음)
+  /// - 서로를 Search하는 포인터들(반복문)은 Tarjan 알고리즘으로 찾아 같은
+  ///   fragment를 공유하게 합니다. 순환 안에서 아직 완성되지 않은 fragment를
+  ///   참조한 fragment는 순환의 첫 fragment가 완성될 때 함께 완성됩니다.
+  /// - fragment는 함수 하나의 Value들에 대한 것이므로 SliceBuilder는 대상
+  ///   함수마다 만들어지며, 그 함수의 annotated variable들이 공유합니다.
+  ///   fragment들은 SliceBuilder가 사라질 때 해제됩니다.
+  class SliceBuilder
+  {
+    friend class SliceWalker;
+
+    using FragmentKey = PointerIntPair<Value *, 1, bool>;
+
+    FunctionDependency *function_dependency;
+    DependencyMap *dependency_map;
+    DenseMap<FragmentKey, SliceWalker::Fragment *> fragments;
+    SpecificBumpPtrAllocator<SliceWalker::Fragment> allocator;
+    SpecificBumpPtrAllocator<InstructionDependency> slice_allocator;
+    SmallVector<SliceWalker::Fragment *, 16> scc_stack;
+    std::vector<std::unique_ptr<SliceWalker>> walkers;
+    FragmentKey pending;
+    unsigned next_index = 0;
+    Instruction *target = nullptr;
+    bool target_perpect = false;
+
+  public:
+
+    SliceBuilder(FunctionDependency *FD, DependencyMap *DM)
+      : function_dependency(FD), dependency_map(DM) { }
+
+    /// V에 대한 slice를 Slice에 채웁니다.
+    void build(Value *V, InstructionDependency *Slice)
+    {
+      start(V, Slice);
+      resume();
+    }
+
+    /// V에 대한 slice를 Slice에 채우기 시작합니다. 실제 탐색은 resume에서
+    /// 이루어집니다. 이전 slice의 탐색이 끝난 뒤에만 호출할 수 있습니다.
+    void start(Value *V, InstructionDependency *Slice);
+
+    /// [정보]
+    /// start로 시작한 탐색을 이어서 진행합니다. 탐색이 모두 끝나면 true를
+    /// 반환합니다.
+    ///
+    /// [보충]
+    /// Target이 주어지면 Target이 slice에 속하는 것이 확인되는 즉시 멈추고
+    /// false를 반환합니다. (Perpect가 true라면 Perpect로 속할 때) 이때 Target은
+    /// 아직 만들고 있는 fragment에만 있을 수 있지만, 그 fragment는 언젠가
+    /// Slice에 merge되므로 답은 바뀌지 않습니다.
+    bool resume(Instruction *Target = nullptr, bool Perpect = false);
+
+  private:
+
+    /// Search(V, P)의 결과를 fragment로 재사용할지 결정합니다. 메모리 접근이
+    /// 있는 포인터만 fragment를 만듭니다.
+    bool isFragmentRoot(Value *V)
+    {
+      return V->getType()->isPointerTy() &&
+        !function_dependency->getAccessIndex()->getAccesses(V).empty();
+    }
+
+    void finishFragment(SliceWalker::Fragment *F);
+  };
+
+  struct SliceWalker::Fragment
+  {
+    InstructionDependency *slice;
+    unsigned index;
+    unsigned lowlink;
+    bool done;
+  };
+
+  SliceWalker::SearchAction SliceWalker::resolveSearch(Value *V, bool P, bool ROOT)
+  {
+    if (ROOT || !builder->isFragmentRoot(V))
+      return SA_Expand;
+
+    Fragment *F = builder->fragments.lookup(SliceBuilder::FragmentKey(V, P));
+    if (!F) {
+      builder->pending = SliceBuilder::FragmentKey(V, P);
+      return SA_Suspend;
+    }
+    if (F == fragment)
+      return SA_Expand;
+
+    // 완성되지 않은 fragment는 같은 순환에 속하므로, 지금 merge한 부분 외의
+    // 나머지는 순환의 첫 fragment가 완성될 때 함께 모입니다. 따라서 한
+    // fragment는 한 번만 merge합니다.
+    if (merged.insert(F).second)
+      inst_dependency->merge(*F->slice);
+    if (!F->done && fragment)
+      fragment->lowlink = std::min(fragment->lowlink, F->lowlink);
+    return SA_Skip;
+  }
+
+  bool SliceWalker::shouldPause()
+  {
+    return builder->target && inst_dependency->hasInstructoin(builder->target, builder->target_perpect);
+  }
+
+  void SliceBuilder::start(Value *V, InstructionDependency *Slice)
+  {
+    assert(walkers.empty() && "Previous slice is not finished!");
+    walkers.push_back(std::make_unique<SliceWalker>(
+      function_dependency, dependency_map, this, nullptr, Slice, V, true, true));
+  }
+
+  bool SliceBuilder::resume(Instruction *Target, bool Perpect)
+  {
+    target = Target;
+    target_perpect = Perpect;
+
+    while (!walkers.empty())
+    {
+      SliceWalker *walker = walkers.back().get();
+      SliceWalker::WalkResult result = walker->walk();
+      if (result == SliceWalker::WR_Paused)
+        return false;
+      if (result == SliceWalker::WR_Done) {
+        if (walker->fragment)
+          finishFragment(walker->fragment);
+        walkers.pop_back();
+        continue;
+      }
+
+      // 필요한 fragment를 먼저 만듭니다. 멈춘 탐색은 fragment가 만들어진 뒤
+      // 같은 Search 작업부터 다시 시작합니다.
+      SliceWalker::Fragment *fragment = new (allocator.Allocate()) SliceWalker::Fragment{
+        new (slice_allocator.Allocate())
+          InstructionDependency(function_dependency->getInstructionNumbering()),
+        next_index, next_index, false };
+      next_index++;
+      fragments[pending] = fragment;
+      scc_stack.push_back(fragment);
+      walkers.push_back(std::make_unique<SliceWalker>(
+        function_dependency, dependency_map, this, fragment, fragment->slice,
+        pending.getPointer(), pending.getInt(), false));
+    }
+
+    target = nullptr;
+    return true;
+  }
+
+  /// F의 탐색이 끝났을 때 호출됩니다. F가 순환의 첫 fragment라면 순환에
+  /// 속한 fragment들이 모두 F의 결과를 공유하며 완성됩니다.
+  void SliceBuilder::finishFragment(SliceWalker::Fragment *F)
+  {
+    if (F->lowlink != F->index)
+      return;
+
+    SliceWalker::Fragment *member;
+    do {
+      member = scc_stack.pop_back_val();
+      member->slice = F->slice;
+      member->done = true;
+    } while (member != F);
+  }
+
+  /// [정보]
+  /// "Instruction I가 Value A의 slice에 속하는가?"라는 질문에 필요한 만큼만
+  /// 탐색하여 답합니다. 전체 slice를 만드는 방식(BottomUpDependencyChecker)과
+  /// 같은 답을 냅니다.
+  ///
+  /// [보충]
+  /// - A마다 SliceBuilder를 하나씩 두고, I를 찾는 즉시 탐색을 멈춥니다.
+  ///   다음 질문은 멈춘 곳에서부터 이어서 탐색합니다.
+  /// - 이미 찾은 Instruction과 탐색이 끝난 A에 대한 질문은 탐색 없이 답합니다.
+  ///   I가 slice에 없다는 답은 A의 탐색이 모두 끝나야 알 수 있습니다.
+  /// - 피호출 함수들의 요약정보가 모두 계산되어 있어야 합니다. (IDCAnalysis)
+  /// - 여러 스레드에서 동시에 사용할 수 없습니다.
+  class SliceQuery
+  {
+    using FoundKey = PointerIntPair<Instruction *, 1, bool>;
+
+    struct Variable
+    {
+      InstructionDependency *slice;
+      std::unique_ptr<SliceBuilder> builder;
+      DenseSet<FoundKey> found;
+    };
+
+    FunctionDependency *function_dependency;
+    DependencyMap *dependency_map;
+    DenseMap<Value *, std::unique_ptr<Variable>> variables;
+    SpecificBumpPtrAllocator<InstructionDependency> allocator;
+
+  public:
+
+    /// FD는 prepareWalk가 호출된 대상 함수의 FunctionDependency입니다.
+    SliceQuery(FunctionDependency *FD, DependencyMap *DM)
+      : function_dependency(FD), dependency_map(DM) { }
+
+    /// I가 A의 slice에 속하는지 확인합니다. Perpect가 true라면 Perpect로
+    /// 속하는 경우에만 true를 반환합니다.
+    bool isInSlice(Value *A, Instruction *I, bool Perpect = false)
+    {
+      Variable& variable = getVariable(A);
+      if (variable.slice->hasInstructoin(I, Perpect) || variable.found.count(FoundKey(I, Perpect)))
+        return true;
+      if (!variable.builder)
+        return false;
+
+      if (variable.builder->resume(I, Perpect)) {
+        variable.builder.reset();
+        return variable.slice->hasInstructoin(I, Perpect);
+      }
+      variable.found.insert(FoundKey(I, Perpect));
+      return true;
+    }
+
+    /// A의 slice를 끝까지 만들어 반환합니다.
+    InstructionDependency *getSlice(Value *A)
+    {
+      Variable& variable = getVariable(A);
+      if (variable.builder) {
+        variable.builder->resume();
+        variable.builder.reset();
+      }
+      return variable.slice;
+    }
+
+  private:
+
+    Variable& getVariable(Value *A)
+    {
+      std::unique_ptr<Variable>& variable = variables[A];
+      if (!variable) {
+        variable = std::make_unique<Variable>();
+        variable->slice = new (allocator.Allocate())
+          InstructionDependency(function_dependency->getInstructionNumbering());
+        variable->builder = std::make_unique<SliceBuilder>(function_dependency, dependency_map);
+        variable->builder->start(A, variable->slice);
+      }
+      return *variable;
+    }
+  };
+
+  /// This class must be called only once by each target-function.
+  ///
+  /// [보충]
+  /// - 각 slice는 IR과 피호출 함수의 요약정보를 읽기만 하므로, -idc-slice-threads가
+  ///   1보다 크면 annotated variable들의 slice를 ThreadPool에서 동시에 만듭니다.
+  /// - 이를 위해 대상 함수의 모든 CallInst에 대해 processCallInst를 먼저 한 번씩
+  ///   호출하여, 요약정보 계산과 call_dependency 기록을 미리 끝내 둡니다. 그 뒤의
+  ///   processCallInst는 DependencyMap을 읽기만 합니다.
+  /// - 결과는 annotated variable의 순서대로 InstructionDependencyMap에 넣습니다.
+  class BottomUpDependencyChecker
+    : public DependencyWalker<BottomUpDependencyChecker>
+  {
+    friend class DependencyWalker<BottomUpDependencyChecker>;
+
+  public:
+
+    BottomUpDependencyChecker(Function *, SmallVector<Value *, 16> V,
+      DependencyMap *DM, FunctionDependency *FD, InstructionDependencyMap *IDM)
+      : DependencyWalker(FD, DM)
+    {
+      const InstructionNumbering *numbering = FD->getInstructionNumbering();
+
+      // 같은 변수에 annotation이 여러 번 붙어 있어도 slice는 한 번만 만듭니다.
+      SmallVector<Value *, 16> values;
+      for (Value *value : V)
+        if (!IDM->hasDependency(value)) {
+          IDM->createDependency(value, numbering);
+          values.push_back(value);
+        }
+
+      if (IDCSliceThreads <= 1 || values.size() <= 1) {
+        SliceBuilder builder(FD, DM);
+        for (Value *value : values)
+          builder.build(value, IDM->getDependency(value));
+        return;
+      }
+
+      prepareCallees();
+
+      // slice들은 이 스레드에서 미리 만들어 두었으므로, 각 스레드는 채우기만
+      // 합니다. 스레드마다 SliceBuilder를 하나씩 두어 fragment를 공유합니다.
+      unsigned tasks = std::min<size_t>(IDCSliceThreads, values.size());
+      ThreadPool pool(hardware_concurrency(tasks));
+      for (unsigned t = 0; t < tasks; t++)
+        pool.async([&, t] {
+          SliceBuilder builder(FD, DM);
+          for (size_t i = t; i < values.size(); i += tasks)
+            builder.build(values[i], IDM->getDependency(values[i]));
+        });
+      pool.wait();
+    }
+
+  private:
+
+    void prepareCallees()
+    {
+      for (BasicBlock& basic_block : *function)
+        for (Instruction& inst : basic_block)
+          if (CallInst *ci = dyn_cast<CallInst> (&inst))
+            processCallInst(ci);
+    }
+    
+  };
+
+  class DependencyManager
+  {
+  public:
+    using AnnotatedTuple = std::tuple<Value *, CallInst *>;
+    using AnnotatedVector = SmallVector<AnnotatedTuple, 8>;
+
+  private:
+    DependencyMap *map;
+    DependencyMap *annotated_map;
+    Function *target_function;
+    AnnotatedVector annotated_value;
+    SmallVector<Value *, 16> annotated_target;
+
+  public:
+
+    DependencyManager(Function *TargetFunction, DependencyMap *Map, DependencyMap *AnnotatedMap)
+      : map(Map), annotated_map(AnnotatedMap), target_function(TargetFunction)
+    {
+      calAnnotatedValue();
+    }
+
+    /// State가 주어지고 대상 함수가 영향을 받지 않았다면 slice를 기록에서
+    /// 불러옵니다.
+    void run(IncrementalState *State = nullptr)
+    {
+      FunctionDependency *fd = annotated_map->createDependency(target_function);
+      fd->prepareNumbering();
+      InstructionDependencyMap *idm = new InstructionDependencyMap();
+
+      if (State && State->loadSlices(fd, annotated_target, map, idm)) {
+        NumIncrementalSlices++;
+      } else {
+        fd->prepareWalk();
+        recursion_map = new DependencyMap();
+        BottomUpDependencyChecker checker(target_function, annotated_target, map, fd, idm);
+        delete recursion_map;
+        recursion_map = nullptr;
+      }
+      
+      fd->setInstructionDependencyMap(idm);
+      annotated_map->addDependency(target_function, fd);
+    }
+
+    AnnotatedVector& getAnnotatedVariableList()
+    {
+      return annotated_value;
+    }
+    
+    StringRef getAnnotatedMessage(CallInst *ci)
+    {
+      ConstantExpr *ce = cast<ConstantExpr>(ci->getArgOperand(1));
+      GlobalVariable *gv = cast<GlobalVariable>(ce->getOperand(0));
+      Constant *cs = gv->getInitializer();
+      ConstantDataArray *cda = cast<ConstantDataArray>(cs);
+      return cda->getAsCString();
+    }
+
+  private:
+
+    bool isAnnotated(Value *v)
+    {
+      for (AnnotatedTuple at : annotated_value) {
+        if (std::get<0>(at) == v)
+          return true;
+      }
+      return false;
+    }
+
+    /// get all annotated-variable in target-function
+    void calAnnotatedValue()
+    {
+      for (BasicBlock& basic_block : *target_function)
+        for (Instruction& inst : basic_block)
+          if (CallInst *ci = dyn_cast<CallInst> (&inst))
+            if (ci->getCalledFunction()->getName() == llvm_annotate_variable) {
+              annotated_value.push_back(AnnotatedTuple((
+                cast<BitCastInst>(ci->getArgOperand(0)))->getOperand(0), ci));
+              annotated_target.push_back((cast<BitCastInst>(ci->getArgOperand(0)))->getOperand(0));
+            }
+    }
+
+  };
+
+  ///---------------------------------------------------------
+  ///
+  ///            LLVM-IR Nodes Traversal
+  ///
+  ///---------------------------------------------------------
+  
+  ///---------------------------------------------------------
+  ///
+  ///            Dependency Printer
+  ///
+  ///---------------------------------------------------------
+
+  class DependencyPrinter
+  {
+    Function *target_function;
+    DependencyMap *annotated_map;
+    std::string tab;
+
+  public:
+
+    DependencyPrinter(DependencyMap *AnnotatedMap)
+      : annotated_map(AnnotatedMap)
+    {
+    }
+
+    void setTargetFunction(Function *F)
+    {
+      target_function = F;
+    }
+
+    void printTargetFunctionName()
+    {
+      out() << "Function - " << target_function->getName() << "\n";
+    }
+
+    void printTargetFunctionAnnotatedVariable(DependencyManager *DM)
+    {
+      DependencyManager::AnnotatedVector vec = DM->getAnnotatedVariableList();
+      increaseTab();
+      if (vec.size() == 0)
+      {
+        out() << "Annotated Variable is not found.\n\n";
+        decreaseTab();
+        return;
+      }
+      out() << "Annotated Variable List :\n";
+      increaseTab();
+      for (DependencyManager::AnnotatedTuple& tu : vec)
+      {
+        StringRef message = DM->getAnnotatedMessage(std::get<1>(tu));
+        out() << "- Annotated : " << std::get<0>(tu)->getName() << "(message: " << message << ")\n";
+      }
+      out() << "\n";
+      decreaseTab();
+      decreaseTab();
+    }
+
+    void printTargetFunctionDependencyInstruction()
+    {
+      FunctionDependency *dependency = annotated_map->getDependency(target_function);
+      InstructionDependencyMap *inst_map = dependency->getInstrctionDependencyMap();
+      
+      increaseTab();
+      for (auto element : *inst_map)
+      {
+        out() << "Annotated-Variable : " << element.first->getName() << "\n";
+        increaseTab();
+        InstructionDependency *inst_dependency = element.second;
+        for (auto inst : *inst_dependency)
+        {
+          out() << (inst.second ? "(Perpect)" : "(Maybe)") << *inst.first << "\n";
+        }
+        out() << "\n";
+        decreaseTab();
+      }
+      decreaseTab();
+    }
+
+  private:
+
+    void increaseTab()
+    {
+      tab += "    ";
+    }
+    void decreaseTab()
+    {
+      tab.erase(0, 4);
+    }
+
+    raw_ostream& out()
+    {
+      return errs() << tab;
+    }
+
+  };
+
+  ///---------------------------------------------------------
+  ///
+  ///            Fault Equivalence
+  ///
+  ///---------------------------------------------------------
+
+  static bool isInjectableType(Type *T)
+  {
+    return (T->isIntegerTy() && T->getIntegerBitWidth() <= 64) ||
+      T->isFloatTy() || T->isDoubleTy() || T->isPointerTy();
+  }
+
+  /// [정보]
+  /// I에 fault-injection hook을 넣을 수 있는지 확인합니다. 값을 만드는
+  /// Instruction은 그 값을, StoreInst는 저장하는 값을 바꿉니다.
+  ///
+  /// [보충]
+  /// 64bit 이하의 정수, float, double, 포인터 값만 다룹니다. AllocaInst는
+  /// entry 블록을 나누지 않도록 제외합니다.
+  static bool isInjectableSite(Instruction *I)
+  {
+    if (StoreInst *si = dyn_cast<StoreInst> (I))
+      return isInjectableType(si->getValueOperand()->getType());
+    if (isa<AllocaInst> (I) || I->isTerminator() || I->isEHPad() ||
+        !isInjectableType(I->getType()))
+      return false;
+    return I->getParent()->getFirstInsertionPt() != I->getParent()->end();
+  }
+
+  /// [정보]
+  /// 한 함수의 slice site들을 fault가 같은 결과를 내는 equivalence class로
+  /// 나눕니다. 각 class는 Instruction 번호가 가장 작은 site 하나가 대표하고,
+  /// 대표 site의 weight는 class의 크기입니다.
+  ///
+  /// [보충]
+  /// - 값을 그대로 옮기기만 하는 Instruction(copy)과 그 값을 만든
+  ///   Instruction(source)을 같은 class로 묶습니다. copy는 다음과 같습니다.
+  ///     bitcast 등 비트를 바꾸지 않는 CastInst   source: 피연산자
+  ///     들어오는 값이 하나뿐인 PHINode           source: 그 값
+  ///     StoreInst                                source: 저장하는 값
+  ///     store 하나, load 하나만 쓰는 AllocaInst의 LoadInst  source: 그 store
+  /// - source의 값을 copy만 쓰고, 두 Instruction이 항상 같은 횟수로 실행될
+  ///   때만 묶습니다. 그래야 source의 n번째 실행에 넣은 fault와 copy의 n번째
+  ///   실행에 넣은 fault가 같습니다.
+  /// - Perpect site와 Maybe site는 서로 묶지 않습니다.
+  /// - hook을 넣을 수 없는 site(isInjectableSite)는 어느 class에도 속하지
+  ///   않고 weight가 0입니다.
+  class FaultEquivalence
+  {
+    std::vector<unsigned> parent;
+    std::vector<unsigned> weight;
+    BitVector sites;
+
+  public:
+
+    FaultEquivalence(FunctionDependency *FD)
+    {
+      InstructionNumbering *numbering = FD->getInstructionNumbering();
+      const DataLayout& data_layout = FD->getFunction()->getParent()->getDataLayout();
+      unsigned size = numbering->size();
+      BitVector perpect(size), maybe(size);
+      for (auto& element : *FD->getInstrctionDependencyMap()) {
+        perpect |= element.second->getPerpectBits();
+        maybe |= element.second->getMaybeBits();
+      }
+      maybe.reset(perpect);
+      sites = perpect;
+      sites |= maybe;
+      for (unsigned n : sites.set_bits())
+        if (!isInjectableSite(numbering->getInstruction(n)))
+          sites.reset(n);
+
+      parent.resize(size);
+      for (unsigned n = 0; n < size; n++)
+        parent[n] = n;
+
+      for (unsigned n : sites.set_bits()) {
+        Instruction *copy = numbering->getInstruction(n);
+        Instruction *source = getSource(copy, data_layout);
+        if (!source)
+          continue;
+        unsigned m = numbering->getNumber(source);
+        if (!sites.test(m) || perpect.test(m) != perpect.test(n))
+          continue;
+        merge(m, n);
+      }
+
+      weight.assign(size, 0);
+      for (unsigned n : sites.set_bits())
+        weight[find(n)]++;
+      for (unsigned n : sites.set_bits())
+        if (find(n) != n)
+          NumEquivalentSites++;
+    }
+
+    /// N이 속한 class의 대표 site 번호입니다.
+    unsigned getRepresentative(unsigned N)
+    {
+      return find(N);
+    }
+
+    /// N이 대표 site라면 class의 크기를, 아니라면 0을 반환합니다.
+    unsigned getWeight(unsigned N) const
+    {
+      return weight[N];
+    }
+
+  private:
+
+    unsigned find(unsigned N)
+    {
+      while (parent[N] != N) {
+        parent[N] = parent[parent[N]];
+        N = parent[N];
+      }
+      return N;
+    }
+
+    /// 번호가 작은 쪽을 대표로 남깁니다.
+    void merge(unsigned A, unsigned B)
+    {
+      A = find(A);
+      B = find(B);
+      if (A == B)
+        return;
+      if (A < B)
+        parent[B] = A;
+      else
+        parent[A] = B;
+    }
+
+    /// I가 copy라면 그 source를, 아니라면 nullptr를 반환합니다.
+    static Instruction *getSource(Instruction *I, const DataLayout& DL)
+    {
+      Instruction *source = nullptr;
+      if (CastInst *ci = dyn_cast<CastInst> (I)) {
+        if (ci->isNoopCast(DL))
+          source = dyn_cast<Instruction>(ci->getOperand(0));
+      } else if (PHINode *phi = dyn_cast<PHINode> (I)) {
+        source = dyn_cast_or_null<Instruction>(phi->hasConstantValue());
+      } else if (StoreInst *si = dyn_cast<StoreInst> (I)) {
+        if (!si->isVolatile())
+          source = dyn_cast<Instruction>(si->getValueOperand());
+      } else if (LoadInst *li = dyn_cast<LoadInst> (I)) {
+        return getStoreSource(li);
+      }
+
+      if (!source || !source->hasOneUser() || !executesWith(source, I))
+        return nullptr;
+      return source;
+    }
+
+    /// store 하나와 li만 쓰는 AllocaInst에서 li가 읽는 값을 쓴 store입니다.
+    static Instruction *getStoreSource(LoadInst *LI)
+    {
+      AllocaInst *alloca = dyn_cast<AllocaInst>(LI->getPointerOperand());
+      if (!alloca || LI->isVolatile() || !alloca->hasNUses(2))
+        return nullptr;
+
+      StoreInst *store = nullptr;
+      for (User *user : alloca->users())
+        if (user != LI)
+          store = dyn_cast<StoreInst>(user);
+      if (!store || store->isVolatile() || store->getPointerOperand() != alloca ||
+          store->getValueOperand()->getType() != LI->getType() ||
+          !executesWith(store, LI))
+        return nullptr;
+      return store;
+    }
+
+    /// Source 다음에 I가 실행되며, 두 Instruction의 실행 횟수가 항상 같은지
+    /// 확인합니다.
+    static bool executesWith(Instruction *Source, Instruction *I)
+    {
+      BasicBlock *from = Source->getParent(), *to = I->getParent();
+      if (from == to)
+        return Source->comesBefore(I);
+      return from->getSingleSuccessor() == to && to->getSinglePredecessor() == from;
+    }
+  };
+
+  ///---------------------------------------------------------
+  ///
+  ///            Slice Exporter
+  ///
+  ///---------------------------------------------------------
+
+  static_assert(sizeof(idc_slice_header) == 64, "unexpected slice header layout");
+  static_assert(sizeof(idc_slice_function) == 16, "unexpected slice function layout");
+  static_assert(sizeof(idc_slice_variable) == 24, "unexpected slice variable layout");
+  static_assert(sizeof(idc_slice_site) == 16, "unexpected slice site layout");
+
+  /// [정보]
+  /// 각 대상 함수의 slice를 Runtime/IDCSlice.h 형식의 바이너리 파일로 씁니다.
+  /// fault-injection runtime은 이 파일을 mmap하여 별도의 parsing 없이
+  /// 사용합니다.
+  ///
+  /// [보충]
+  /// - 함수는 모듈 내부의 순서(function id)로, Instruction은 함수 내부의
+  ///   순서(InstructionNumbering의 번호)로 식별됩니다.
+  /// - 각 annotated variable의 site들은 Instruction 번호 순으로 정렬됩니다.
+  /// - 각 site에는 FaultEquivalence가 정한 대표 site와 weight를 기록합니다.
+  /// - instrumenter가 hook을 넣는 site(isInjectableSite)에는
+  ///   IDC_SITE_INJECTABLE을 기록합니다.
+  class SliceExporter
+  {
+    std::vector<idc_slice_function> functions;
+    std::vector<idc_slice_variable> variables;
+    std::vector<idc_slice_site> sites;
+    std::string strings;
+
+  public:
+
+    SliceExporter() : strings(1, '\0') { }
+
+    void addFunction(uint32_t FunctionId, DependencyManager *DM, FunctionDependency *FD)
+    {
+      idc_slice_function function = {};
+      function.function_id = FunctionId;
+      function.name_offset = addString(FD->getFunction()->getName());
+      function.variable_begin = variables.size();
+
+      InstructionDependencyMap *inst_map = FD->getInstrctionDependencyMap();
+      InstructionNumbering *numbering = FD->getInstructionNumbering();
+      FaultEquivalence equivalence(FD);
+      SmallPtrSet<Value *, 8> exported;
+
+      for (DependencyManager::AnnotatedTuple& tu : DM->getAnnotatedVariableList())
+      {
+        Value *value = std::get<0>(tu);
+        if (!inst_map->hasDependency(value) || !exported.insert(value).second)
+          continue;
+
+        idc_slice_variable variable = {};
+        variable.function_id = FunctionId;
+        variable.name_offset = addString(value->getName());
+        variable.annotation_offset = addString(DM->getAnnotatedMessage(std::get<1>(tu)));
+        variable.site_begin = sites.size();
+
+        for (auto inst : *inst_map->getDependency(value))
+        {
+          idc_slice_site site = {};
+          site.instruction_id = numbering->getNumber(inst.first);
+          site.flags = inst.second ? IDC_SITE_PERFECT : 0;
+          if (isInjectableSite(inst.first))
+            site.flags |= IDC_SITE_INJECTABLE;
+          site.representative = equivalence.getRepresentative(site.instruction_id);
+          site.weight = equivalence.getWeight(site.instruction_id);
+          sites.push_back(site);
+        }
+        std::sort(sites.begin() + variable.site_begin, sites.end(),
+          [](const idc_slice_site& A, const idc_slice_site& B) {
+            return A.instruction_id < B.instruction_id;
+          });
+
+        variable.site_count = sites.size() - variable.site_begin;
+        variables.push_back(variable);
+      }
+
+      function.variable_count = variables.size() - function.variable_begin;
+      functions.push_back(function);
+    }
+
+    bool write(StringRef Path)
+    {
+      std::error_code EC;
+      raw_fd_ostream os(Path, EC, sys::fs::OF_None);
+      if (EC) {
+        errs() << "Cannot write slice output '" << Path << "': " << EC.message() << "\n";
+        return false;
+      }
+
+      uint64_t function_offset = sizeof(idc_slice_header);
+      uint64_t variable_offset = function_offset + functions.size() * sizeof(idc_slice_function);
+      uint64_t site_offset = variable_offset + variables.size() * sizeof(idc_slice_variable);
+      uint64_t string_offset = site_offset + sites.size() * sizeof(idc_slice_site);
+
+      support::endian::Writer W(os, support::little);
+      os.write(IDC_SLICE_MAGIC, 4);
+      W.write<uint32_t>(IDC_SLICE_VERSION);
+      W.write<uint32_t>(functions.size());
+      W.write<uint32_t>(variables.size());
+      W.write<uint32_t>(sites.size());
+      W.write<uint32_t>(strings.size());
+      W.write<uint32_t>(IDC_SLICE_BYTE_ORDER);
+      W.write<uint32_t>(0);
+      W.write<uint64_t>(function_offset);
+      W.write<uint64_t>(variable_offset);
+      W.write<uint64_t>(site_offset);
+      W.write<uint64_t>(string_offset);
+
+      for (idc_slice_function& function : functions) {
+        W.write<uint32_t>(function.function_id);
+        W.write<uint32_t>(function.name_offset);
+        W.write<uint32_t>(function.variable_begin);
+        W.write<uint32_t>(function.variable_count);
+      }
+      for (idc_slice_variable& variable : variables) {
+        W.write<uint32_t>(variable.function_id);
+        W.write<uint32_t>(variable.name_offset);
+        W.write<uint32_t>(variable.annotation_offset);
+        W.write<uint32_t>(variable.site_begin);
+        W.write<uint32_t>(variable.site_count);
+        W.write<uint32_t>(variable.reserved);
+      }
+      for (idc_slice_site& site : sites) {
+        W.write<uint32_t>(site.instruction_id);
+        W.write<uint32_t>(site.flags);
+        W.write<uint32_t>(site.representative);
+        W.write<uint32_t>(site.weight);
+      }
+      os << strings;
+      return true;
+    }
+
+  private:
+
+    uint32_t addString(StringRef S)
+    {
+      uint32_t offset = strings.size();
+      strings.append(S.begin(), S.end());
+      strings.push_back('\0');
+      return offset;
+    }
+  };
+
+  ///---------------------------------------------------------
+  ///
+  ///            Site Ranking
+  ///
+  ///---------------------------------------------------------
+
+  /// [정보]
+  /// 함수 안의 각 블록이 함수가 한 번 호출될 때 몇 번 실행되는지 추정합니다.
+  ///
+  /// [보충]
+  /// BranchProbabilityInfo는 !prof branch weight가 있으면 그것을, 없으면
+  /// loop 구조 등으로 추정한 확률을 사용하므로, PGO profile이 붙은 모듈에서는
+  /// profile에 따른 빈도가 나옵니다.
+  class BlockFrequencyEstimate
+  {
+    DenseMap<const BasicBlock *, double> frequencies;
+
+  public:
+
+    BlockFrequencyEstimate(Function *F)
+    {
+      TargetLibraryInfoImpl tlii(Triple(F->getParent()->getTargetTriple()));
+      TargetLibraryInfo tli(tlii, F);
+      DominatorTree dt(*F);
+      PostDominatorTree pdt(*F);
+      LoopInfo li(dt);
+      BranchProbabilityInfo bpi(*F, li, &tli, &dt, &pdt);
+      BlockFrequencyInfo bfi(*F, bpi, li);
+
+      double entry = bfi.getEntryFreq();
+      for (BasicBlock& basic_block : *F)
+        frequencies[&basic_block] = bfi.getBlockFreq(&basic_block).getFrequency() / entry;
+    }
+
+    double getFrequency(const BasicBlock *BB) const
+    {
+      return frequencies.lookup(BB);
+    }
+  };
+
+  /// [정보]
+  /// slice site들을 예상 실행 횟수에 equivalence class의 weight를 곱한
+  /// score 순으로 정렬하여 텍스트 파일로 씁니다. fault-injection campaign은
+  /// 이 score에 비례하여 site를 고르면 별도의 profiling 없이 동적 실행
+  /// 횟수에 맞게 site를 고를 수 있습니다.
+  ///
+  /// [보충]
+  /// - site의 실행 횟수는 함수의 호출 횟수와 블록의 BlockFrequencyEstimate를
+  ///   곱한 값입니다.
+  /// - 함수의 호출 횟수는 PGO entry count가 있으면 그것을 쓰고, 없으면
+  ///   CallGraph의 SCC를 위에서 아래로 방문하며 호출하는 쪽의 호출 횟수와
+  ///   call이 있는 블록의 빈도를 곱해 더합니다. 모듈 안에 호출하는 함수가
+  ///   없는 함수(main 등)는 한 번 호출된다고 봅니다. 같은 SCC 안의 재귀
+  ///   호출은 더하지 않습니다.
+  /// - 파일의 형식은 다음과 같습니다. 첫 줄 다음부터 한 줄에 site 하나씩,
+  ///   score가 큰 순서로 씁니다. weight가 0인 site는 다른 site가 대표합니다.
+  ///   hook을 넣을 수 없는 site(isInjectableSite)는 쓰지 않습니다.
+  ///
+  ///     IDCRANK 1
+  ///     <site id(hex)> <score> <frequency> <weight> <P|M> <function> <instruction>
+  class SiteRanking
+  {
+    struct Site
+    {
+      uint64_t id;
+      double frequency;
+      unsigned weight;
+      bool perpect;
+      StringRef function;
+      unsigned instruction;
+
+      double getScore() const { return frequency * weight; }
+    };
+
+    std::vector<Site> sites;
+    DenseMap<const Function *, double> call_counts;
+    DenseMap<const Function *, std::unique_ptr<BlockFrequencyEstimate>> estimates;
+
+  public:
+
+    SiteRanking(Module &M)
+    {
+      CallGraph call_graph(M);
+      std::vector<std::vector<CallGraphNode *>> sccs;
+      DenseMap<const Function *, unsigned> scc_ids;
+      for (auto it = scc_begin(&call_graph); !it.isAtEnd(); ++it) {
+        for (CallGraphNode *node : *it)
+          if (Function *function = node->getFunction())
+            scc_ids[function] = sccs.size();
+        sccs.push_back(*it);
+      }
+
+      // scc_iterator는 피호출 함수의 SCC를 먼저 방문하므로 거꾸로 돕니다.
+      for (auto scc = sccs.rbegin(); scc != sccs.rend(); ++scc) {
+        for (CallGraphNode *node : *scc) {
+          Function *function = node->getFunction();
+          if (!function || function->isDeclaration())
+            continue;
+          double& count = call_counts[function];
+          if (auto entry_count = function->getEntryCount())
+            count = entry_count->getCount();
+          else if (count == 0)
+            count = 1;
+
+          BlockFrequencyEstimate *estimate = getEstimate(function);
+          unsigned scc_id = scc_ids[function];
+          for (BasicBlock& basic_block : *function)
+            for (Instruction& inst : basic_block)
+              if (CallBase *call = dyn_cast<CallBase> (&inst)) {
+                Function *callee = call->getCalledFunction();
+                if (!callee || callee->isDeclaration() || scc_ids.lookup(callee) == scc_id)
+                  continue;
+                call_counts[callee] += count * estimate->getFrequency(&basic_block);
+              }
+        }
+      }
+    }
+
+    void addFunction(uint32_t FunctionId, FunctionDependency *FD)
+    {
+      Function *function = FD->getFunction();
+      InstructionNumbering *numbering = FD->getInstructionNumbering();
+      BlockFrequencyEstimate *estimate = getEstimate(function);
+      double call_count = call_counts.lookup(function);
+      FaultEquivalence equivalence(FD);
+
+      BitVector perpect(numbering->size()), maybe(numbering->size());
+      for (auto& element : *FD->getInstrctionDependencyMap()) {
+        perpect |= element.second->getPerpectBits();
+        maybe |= element.second->getMaybeBits();
+      }
+      maybe |= perpect;
+
+      for (unsigned n : maybe.set_bits()) {
+        Instruction *inst = numbering->getInstruction(n);
+        if (!isInjectableSite(inst))
+          continue;
+        Site site;
+        site.id = IDC_INJECT_SITE_ID(FunctionId, n);
+        site.frequency = call_count * estimate->getFrequency(inst->getParent());
+        site.weight = equivalence.getWeight(n);
+        site.perpect = perpect.test(n);
+        site.function = function->getName();
+        site.instruction = n;
+        sites.push_back(site);
+      }
+    }
+
+    bool write(StringRef Path)
+    {
+      std::error_code EC;
+      raw_fd_ostream os(Path, EC, sys::fs::OF_Text);
+      if (EC) {
+        errs() << "Cannot write site ranking '" << Path << "': " << EC.message() << "\n";
+        return false;
+      }
+
+      std::stable_sort(sites.begin(), sites.end(), [](const Site& A, const Site& B) {
+        if (A.getScore() != B.getScore())
+          return A.getScore() > B.getScore();
+        if (A.frequency != B.frequency)
+          return A.frequency > B.frequency;
+        return A.id < B.id;
+      });
+
+      os << "IDCRANK 1\n";
+      for (Site& site : sites)
+        os << format_hex_no_prefix(site.id, 1) << ' ' << format("%.6g", site.getScore())
+           << ' ' << format("%.6g", site.frequency) << ' ' << site.weight << ' '
+           << (site.perpect ? 'P' : 'M') << ' ' << site.function << ' '
+           << site.instruction << '\n';
+      return true;
+    }
+
+  private:
+
+    BlockFrequencyEstimate *getEstimate(Function *F)
+    {
+      std::unique_ptr<BlockFrequencyEstimate>& estimate = estimates[F];
+      if (!estimate)
+        estimate = std::make_unique<BlockFrequencyEstimate>(F);
+      return estimate.get();
+    }
+  };
+
+  ///---------------------------------------------------------
+  ///
+  ///            Fault Injection Instrumenter
+  ///
+  ///---------------------------------------------------------
+
+  /// [정보]
+  /// slice에 속한 Instruction마다 Runtime/IDCInject.h의 injection hook을
+  /// 넣습니다. hook은 site id가 __idc_inject_site와 같을 때만 __idc_inject를
+  /// 호출하여 값을 바꿉니다.
+  ///
+  /// [보충]
+  /// - site id는 (function id << 32) | Instruction 번호로, slice 파일과
+  ///   같습니다. 따라서 Instruction 번호는 hook을 넣기 전에 정합니다.
+  /// - 값을 만드는 Instruction은 그 값을, StoreInst는 저장하는 값을 바꿉니다.
+  /// - hook을 넣는 Instruction은 isInjectableSite로 정합니다.
+  class FaultInjectionInstrumenter
+  {
+    Module& module;
+    const DataLayout& data_layout;
+    GlobalVariable *site_global;
+    FunctionCallee hook;
+    MDNode *unlikely;
+
+  public:
+
+    FaultInjectionInstrumenter(Module& M)
+      : module(M), data_layout(M.getDataLayout())
+    {
+      LLVMContext& context = M.getContext();
+      Type *int64 = Type::getInt64Ty(context);
+      site_global = cast<GlobalVariable>(M.getOrInsertGlobal("__idc_inject_site", int64));
+      hook = M.getOrInsertFunction("__idc_inject", int64, int64, int64, Type::getInt32Ty(context));
+      unlikely = MDBuilder(context).createBranchWeights(1, (1U << 20) - 1);
+    }
+
+    /// FD의 slice들에 속한 Instruction들에 hook을 넣습니다. hook을 넣은
+    /// 경우 true를 반환합니다.
+    bool instrumentFunction(uint32_t FunctionId, FunctionDependency *FD)
+    {
+      InstructionNumbering *numbering = FD->getInstructionNumbering();
+      BitVector perpect(numbering->size()), maybe(numbering->size());
+      for (auto& element : *FD->getInstrctionDependencyMap()) {
+        perpect |= element.second->getPerpectBits();
+        maybe |= element.second->getMaybeBits();
+      }
+      if (IDCInjectMaybe)
+        perpect |= maybe;
+
+      SmallVector<std::pair<Instruction *, uint64_t>, 32> sites;
+      for (unsigned n : perpect.set_bits()) {
+        Instruction *inst = numbering->getInstruction(n);
+        if (isInjectableSite(inst))
+          sites.push_back(std::make_pair(inst, IDC_INJECT_SITE_ID(FunctionId, n)));
+      }
+
+      for (auto& site : sites)
+        instrument(site.first, site.second);
+      NumInjectionSites += sites.size();
+      return !sites.empty();
+    }
+
+  private:
+
+    /// [정보]
+    /// 다음과 같은 모양의 hook을 넣고, 바뀔 수 있는 값을 phi로 대신합니다.
+    ///
+    ///     if (__idc_inject_site == site)
+    ///       value' = __idc_inject(site, value, bits)
+    ///     value'' = phi(value, value')
+    void instrument(Instruction *I, uint64_t Site)
+    {
+      Value *value;
+      Instruction *insert_point;
+      if (StoreInst *si = dyn_cast<StoreInst> (I)) {
+        value = si->getValueOperand();
+        insert_point = si;
+      } else {
+        value = I;
+        insert_point = isa<PHINode> (I) ? &*I->getParent()->getFirstInsertionPt() : I->getNextNode();
+      }
+
+      Type *type = value->getType();
+      IRBuilder<> builder(insert_point);
+      Value *site = builder.getInt64(Site);
+      Value *armed = builder.CreateICmpEQ(
+        builder.CreateLoad(builder.getInt64Ty(), site_global), site);
+      BasicBlock *head = builder.GetInsertBlock();
+      Instruction *then = SplitBlockAndInsertIfThen(armed, insert_point, false, unlikely);
+
+      builder.SetInsertPoint(then);
+      Value *raw = toInt64(builder, value);
+      Value *result = builder.CreateCall(hook, { site, raw, builder.getInt32(getBitWidth(type)) });
+      Value *corrupted = fromInt64(builder, result, type);
+
+      builder.SetInsertPoint(insert_point);
+      PHINode *phi = builder.CreatePHI(type, 2);
+      phi->addIncoming(value, head);
+      phi->addIncoming(corrupted, then->getParent());
+
+      if (StoreInst *si = dyn_cast<StoreInst> (I)) {
+        si->setOperand(0, phi);
+        return;
+      }
+      BasicBlock *inject = then->getParent();
+      value->replaceUsesWithIf(phi, [&](Use& U) {
+        Instruction *user = cast<Instruction>(U.getUser());
+        return user != phi && user->getParent() != inject;
+      });
+    }
+
+    unsigned getBitWidth(Type *T)
+    {
+      return T->isPointerTy() ? data_layout.getPointerTypeSizeInBits(T)
+                              : T->getPrimitiveSizeInBits().getFixedSize();
+    }
+
+    Value *toInt64(IRBuilder<>& B, Value *V)
+    {
+      Type *type = V->getType();
+      if (type->isPointerTy())
+        return B.CreatePtrToInt(V, B.getInt64Ty());
+      if (type->isFloatingPointTy())
+        V = B.CreateBitCast(V, B.getIntNTy(getBitWidth(type)));
+      return B.CreateZExt(V, B.getInt64Ty());
+    }
+
+    Value *fromInt64(IRBuilder<>& B, Value *V, Type *T)
+    {
+      if (T->isPointerTy())
+        return B.CreateIntToPtr(V, T);
+      V = B.CreateTrunc(V, B.getIntNTy(getBitWidth(T)));
+      return T->isFloatingPointTy() ? B.CreateBitCast(V, T) : V;
+    }
+  };
+
+  ///---------------------------------------------------------
+  ///
+  ///            Dependency Analysis
+  ///
+  ///---------------------------------------------------------
+
+  /// FunctionPass와 ModulePass가 공유하는 분석 결과와 출력/표시 기능입니다.
+  /// [정보]
+  /// 한 모듈에 대한 분석 결과를 모두 가지고 있습니다.
+  ///
+  /// [보충]
+  /// 요약정보와 slice, DependencyManager들은 모두 이 객체가 가진 arena들에
+  /// 할당되므로, 이 객체가 사라질 때 한 번에 해제됩니다.
+  class DependencyAnalysis
+  {
+    DependencyMap *dependency_map;
+    DependencyMap *annotated_map;
+    DenseMap<Function *, DependencyManager *> function_map;
+    SpecificBumpPtrAllocator<DependencyManager> managers;
+    DenseMap<Function *, SliceQuery *> query_map;
+    SpecificBumpPtrAllocator<SliceQuery> queries;
+    std::unique_ptr<IncrementalState> incremental;
+
+  public:
+
+    DependencyAnalysis()
+    {
+      dependency_map = new DependencyMap();
+      annotated_map = new DependencyMap();
+    }
+
+    ~DependencyAnalysis()
+    {
+      delete annotated_map;
+      delete dependency_map;
     }
 
-    FunctionDependency *processCallInst(CallInst *CI)
+    /// 모듈 전체의 함수 요약정보를 CallGraph의 SCC 순서로 미리 계산합니다.
+    /// -idc-incremental이 주어지면 이전 분석의 기록을 읽어 사용합니다.
+    void runOnCallGraph(CallGraph &CG)
     {
-      FunctionDependency *depends = nullptr;
-      Function *target_function = CI->getCalledFunction();
-      
-      if (dependency_map->hasDependency(target_function)) {
-        depends = dependency_map->getDependency(target_function);
-      } else {
-        depends = new FunctionDependency(target_function);
-        DependencyChecker::run(depends, dependency_map);
-        dependency_map->addDependency(target_function, depends);
-      }
+      if (!IDCIncremental.empty())
+        incremental = std::make_unique<IncrementalState>(IDCIncremental, CG.getModule());
 
-      function_dependency->addFunctionDependency(depends);
+      if (IDCSummaryCache.empty()) {
+        CallGraphDependencyChecker::run(CG, dependency_map, IDCThreads, nullptr, incremental.get());
+        return;
+      }
 
-      return depends;
+      SummaryCache cache(IDCSummaryCache);
+      CallGraphDependencyChecker::run(CG, dependency_map, IDCThreads, &cache, incremental.get());
     }
-    
-    void processBranches(Value *V)
+
+    /// [정보]
+    /// 요약정보 조회(processCallInst의 DependencyMap::getDependency)의 초당
+    /// 횟수를 잽니다. (-idc-lookup-benchmark)
+    ///
+    /// [보충]
+    /// call이 피호출 함수를 찾는 순서처럼 함수들을 섞은 순서로, Rounds번
+    /// 모든 함수를 조회합니다.
+    void benchmarkLookups(Module &M, unsigned Rounds)
     {
-#if IDC_SCAN_CONTROL_FLOW
-      if (Instruction *inst = dyn_cast<Instruction> (V))
-      {
-        BranchManager *bm = function_dependency->getBranchManager();
-        BlockNode *this_node = bm->getNodeFromInstruction(inst);
-        processBlock(this_node);
+      std::vector<Function *> functions;
+      for (Function& function : M)
+        functions.push_back(&function);
+      uint64_t seed = 0x9E3779B97F4A7C15ULL;
+      for (size_t i = functions.size(); i > 1; i--) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        std::swap(functions[i - 1], functions[seed % i]);
       }
-#endif
+
+      size_t found = 0;
+      auto begin = std::chrono::steady_clock::now();
+      for (unsigned round = 0; round < Rounds; round++)
+        for (Function *function : functions)
+          found += dependency_map->getDependency(function) != nullptr;
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+      double lookups = double(functions.size()) * Rounds;
+      errs() << "idc-lookup-benchmark: " << functions.size() << " functions "
+        << format("%.0f", lookups) << " lookups " << format("%.6f", elapsed.count()) << " s "
+        << format("%.1f", lookups / elapsed.count() / 1e6) << " M lookups/s "
+        << format("%.2f", elapsed.count() / lookups * 1e9) << " ns/lookup ("
+        << found / Rounds << " found)\n";
     }
 
-    void processBlock(BlockNode *BN)
+    /// 대상 함수의 annotated variable들에 대한 Dependency를 계산합니다.
+    void analyze(Function *F)
     {
-      bool is_perpect = BN->getFromNodes().size() == 1;
-      for (BlockNode *bn : BN->getFromNodes())
-      {
-        for (BlockNode *x : block_nodes)
-          if (x == bn) return;
-        block_nodes.push_back(bn);
-        if (bn->getBranchInst()->isConditional()) {
-          runBottomUp(bn->getBranchInst()->getCondition(), is_perpect);
-          runSearch(bn->getBranchInst()->getCondition(), is_perpect);
-        }
-        processBlock(bn);
-      }
+      DependencyManager *dm = new (managers.Allocate())
+        DependencyManager(F, dependency_map, annotated_map);
+      dm->run(incremental.get());
+      function_map[F] = dm;
     }
 
-    void runSearch(Value *V, bool P = true, bool ROOT = false)
+    /// -idc-incremental이 주어졌다면 이번 분석의 결과를 기록합니다.
+    void saveIncrementalState(Module &M)
     {
-      for (BasicBlock& basic_block : *function)
-        for (Instruction& inst : basic_block) {
-          if (StoreInst *si = dyn_cast<StoreInst> (&inst))
-          {
-            if (si->getPointerOperand() == V) {
-              runBottomUp(si->getValueOperand(), P && ROOT);
-              runSearch(si->getValueOperand(), P && ROOT);
-            }
-          }
-          else if (CallInst *ci = dyn_cast<CallInst> (&inst))
-          {
-            FunctionDependency *depends = processCallInst(ci);
-            for (size_t i = 0; i < depends->getFunction()->arg_size(); i++)
-              if (depends->getFunctionArgumentDependency(i)->getArgument() == V)
-                for (size_t j = 0; j < depends->getFunction()->arg_size(); j++)
-                  if (depends->getFunctionArgumentDependency(i)->hasArgumentDependency(j)) {
-                    runBottomUp(depends->getFunctionArgumentDependency(j)->getArgument(), P && ROOT);
-                    runSearch(depends->getFunctionArgumentDependency(j)->getArgument(), P && ROOT);
-                  }
-          }
-        }
-      processBranches(V);
+      if (incremental)
+        incremental->save(M, dependency_map, annotated_map);
     }
-    
-  };
 
-  class DependencyManager
-  {
-  public:
-    using AnnotatedTuple = std::tuple<Value *, CallInst *>;
-    using AnnotatedVector = SmallVector<AnnotatedTuple, 8>;
+    /// 대상 함수의 annotated variable들에 대한 Dependency를 계산하고 그 결과를
+    /// metadata로 표시합니다. IR을 바꾼 경우 true를 반환합니다.
+    bool runOnFunction(Function *F)
+    {
+      analyze(F);
+      if (IDCPrintResult)
+        print(F);
+      return check(F);
+    }
 
-  private:
-    DependencyMap *map;
-    DependencyMap *annotated_map;
-    Function *target_function;
-    AnnotatedVector annotated_value;
-    SmallVector<Value *, 16> annotated_target;
+    /// analyze로 검사한 함수인지 확인합니다.
+    bool isAnalyzed(const Function *F) const
+    {
+      return function_map.count(const_cast<Function *>(F));
+    }
 
-  public:
+    /// 함수의 요약정보(반환값, 인자 사이의 Dependency)를 가져옵니다.
+    /// 요약정보가 없는 함수라면 nullptr을 반환합니다.
+    FunctionDependency *getSummary(const Function *F) const
+    {
+      return dependency_map->getDependency(const_cast<Function *>(F));
+    }
 
-    DependencyManager(Function *TargetFunction, DependencyMap *Map, DependencyMap *AnnotatedMap)
-      : target_function(TargetFunction), map(Map), annotated_map(AnnotatedMap)
+    /// 검사한 함수의 annotated variable별 slice를 가져옵니다.
+    /// 검사하지 않은 함수라면 nullptr을 반환합니다.
+    FunctionDependency *getSlices(const Function *F) const
     {
-      calAnnotatedValue();
+      if (!isAnalyzed(F))
+        return nullptr;
+      return annotated_map->getDependency(const_cast<Function *>(F));
     }
 
-    void run()
+    /// [정보]
+    /// I가 A의 slice에 속하는지 확인합니다. Perpect가 true라면 Perpect로
+    /// 속하는 경우에만 true를 반환합니다.
+    ///
+    /// [보충]
+    /// analyze로 검사한 함수라면 계산된 slice에서 찾고, 그렇지 않다면
+    /// SliceQuery로 필요한 만큼만 탐색합니다. 후자는 runOnCallGraph로
+    /// 요약정보를 모두 계산한 뒤에만 사용할 수 있습니다.
+    bool isInSlice(Value *A, Instruction *I, bool Perpect = false)
     {
-      FunctionDependency *fd = new FunctionDependency(target_function);
-      InstructionDependencyMap *idm = new InstructionDependencyMap();
+      Function *F = I->getFunction();
+      if (FunctionDependency *slices = getSlices(F)) {
+        InstructionDependency *slice = slices->getInstrctionDependencyMap()->getDependency(A);
+        return slice && slice->hasInstructoin(I, Perpect);
+      }
 
-      recursion_map = new DependencyMap();
-      BottomUpDependencyChecker checker(target_function, annotated_target, map, fd, idm);
-      delete recursion_map;
-      
-      fd->setInstructionDependencyMap(idm);
-      annotated_map->addDependency(target_function, fd);
+      SliceQuery*& query = query_map[F];
+      if (!query) {
+        FunctionDependency *fd = annotated_map->createDependency(F);
+        fd->prepareWalk();
+        query = new (queries.Allocate()) SliceQuery(fd, dependency_map);
+      }
+      return query->isInSlice(A, I, Perpect);
     }
 
-    AnnotatedVector& getAnnotatedVariableList()
+    /// 검사한 함수들의 slice를 바이너리 파일로 내보냅니다.
+    void exportSlices(Module &M, StringRef Path)
     {
-      return annotated_value;
+      SliceExporter exporter;
+      uint32_t function_id = 0;
+      for (Function& function : M) {
+        auto it = function_map.find(&function);
+        if (it != function_map.end())
+          exporter.addFunction(function_id, it->second, annotated_map->getDependency(&function));
+        function_id++;
+      }
+      exporter.write(Path);
     }
-    
-    StringRef getAnnotatedMessage(CallInst *ci)
+
+    /// 검사한 함수들의 slice site를 예상 실행 횟수 순으로 내보냅니다.
+    void exportRanking(Module &M, StringRef Path)
     {
-      ConstantExpr *ce = cast<ConstantExpr>(ci->getArgOperand(1));
-      GlobalVariable *gv = cast<GlobalVariable>(ce->getOperand(0));
-      Constant *cs = gv->getInitializer();
-      ConstantDataArray *cda = cast<ConstantDataArray>(cs);
-      return cda->getAsCString();
+      SiteRanking ranking(M);
+      uint32_t function_id = 0;
+      for (Function& function : M) {
+        if (function_map.count(&function))
+          ranking.addFunction(function_id, annotated_map->getDependency(&function));
+        function_id++;
+      }
+      ranking.write(Path);
     }
 
-  private:
+    /// -idc-slice-output, -idc-site-ranking이 주어졌다면 그 파일들을 씁니다.
+    void exportResults(Module &M)
+    {
+      if (!IDCSliceOutput.empty())
+        exportSlices(M, IDCSliceOutput);
+      if (!IDCSiteRanking.empty())
+        exportRanking(M, IDCSiteRanking);
+    }
 
-    bool isAnnotated(Value *v)
+    /// [정보]
+    /// 정의된 함수 중 아직 검사하지 않은 함수를 검사합니다.
+    void analyzeAll(Module &M)
     {
-      for (AnnotatedTuple at : annotated_value) {
-        if (std::get<0>(at) == v)
-          return true;
+      for (Function& function : M)
+        if (!function.isDeclaration() && !isAnalyzed(&function))
+          analyze(&function);
+    }
+
+    /// [정보]
+    /// 정의된 모든 함수의 slice에 fault-injection hook을 넣습니다. 검사하지
+    /// 않은 함수는 먼저 검사합니다. IR을 바꾼 경우 true를 반환합니다.
+    ///
+    /// [보충]
+    /// hook을 넣은 뒤에는 이 객체의 slice가 IR과 맞지 않으므로 다시 사용할 수
+    /// 없습니다.
+    bool instrument(Module &M)
+    {
+      analyzeAll(M);
+
+      // hook 선언이 모듈 끝에 추가되기 전에 function id를 정합니다.
+      SmallVector<Function *, 32> functions;
+      for (Function& function : M)
+        functions.push_back(&function);
+      FaultInjectionInstrumenter instrumenter(M);
+
+      bool changed = false;
+      for (uint32_t function_id = 0; function_id < functions.size(); function_id++)
+      {
+        Function *function = functions[function_id];
+        if (function->isDeclaration())
+          continue;
+        changed |= instrumenter.instrumentFunction(function_id,
+          annotated_map->getDependency(function));
       }
-      return false;
+      return changed;
     }
 
-    /// get all annotated-variable in target-function
-    void calAnnotatedValue()
+    void print(Function *F)
     {
-      for (BasicBlock& basic_block : *target_function)
-        for (Instruction& inst : basic_block)
-          if (CallInst *ci = dyn_cast<CallInst> (&inst))
-            if (ci->getCalledFunction()->getName() == llvm_annotate_variable) {
-              annotated_value.push_back(AnnotatedTuple((
-                cast<BitCastInst>(ci->getArgOperand(0)))->getOperand(0), ci));
-              annotated_target.push_back((cast<BitCastInst>(ci->getArgOperand(0)))->getOperand(0));
-            }
+      DependencyPrinter printer(annotated_map);
+      printer.setTargetFunction(F);
+
+      printer.printTargetFunctionName();
+      printer.printTargetFunctionAnnotatedVariable(function_map.lookup(F));
+      printer.printTargetFunctionDependencyInstruction();
+    }
+
+    /// [정보]
+    /// slice에 속한 Instruction에 결과를 metadata로 표시합니다. 어떤 slice에서든
+    /// Perpect인 Instruction은 !idc.dep, 그 외에는 !idc.maybe를 가집니다.
+    /// 표시한 Instruction이 있으면 true를 반환합니다.
+    bool check(Function *F)
+    {
+      FunctionDependency *dependency = annotated_map->getDependency(F);
+      InstructionDependencyMap *inst_map = dependency->getInstrctionDependencyMap();
+      LLVMContext& context = F->getContext();
+      MDNode *mark = MDNode::get(context, None);
+      bool changed = false;
+
+      for (auto& element : *inst_map)
+      {
+        InstructionDependency *inst_dependency = element.second;
+        for (auto inst : *inst_dependency)
+        {
+          if (inst.second) {
+            inst.first->setMetadata(IDCDependencyMD, mark);
+            inst.first->setMetadata(IDCMaybeDependencyMD, nullptr);
+          } else if (!inst.first->getMetadata(IDCDependencyMD)) {
+            inst.first->setMetadata(IDCMaybeDependencyMD, mark);
+          }
+          changed = true;
+        }
+      }
+      return changed;
     }
 
   };
 
   ///---------------------------------------------------------
   ///
-  ///            LLVM-IR Nodes Traversal
-  ///
-  ///---------------------------------------------------------
-  
-  ///---------------------------------------------------------
-  ///
-  ///            Dependency Printer
+  ///       Interprocedural Dependency Checker Pass
   ///
   ///---------------------------------------------------------
 
-  class DependencyPrinter
+  struct InterproceduralDependencyCheckPass : public FunctionPass 
   {
-    Function *target_function;
-    DependencyMap *annotated_map;
-    std::string tab;
+    static char ID;
+    
+    DependencyAnalysis analysis;
 
-  public:
+    InterproceduralDependencyCheckPass()
+      : FunctionPass(ID)
+    {
+    }
 
-    DependencyPrinter(DependencyMap *AnnotatedMap)
-      : annotated_map(AnnotatedMap)
+    bool runOnFunction(Function &F) override
     {
+      return analysis.runOnFunction(&F);
     }
 
-    void setTargetFunction(Function *F)
+    bool doFinalization(Module &M) override
     {
-      target_function = F;
+      analysis.exportResults(M);
+      return false;
     }
 
-    void printTargetFunctionName()
+  };
+
+  /// [정보]
+  /// 모듈 단위로 동작하는 Dependency Check Pass입니다. 모든 함수의 요약정보를
+  /// CallGraph의 SCC 순서로 한 번씩 계산한 뒤, 각 함수를 검사합니다.
+  /// 재귀호출이 있어도 함수를 방문하는 순서와 관계없이 같은 결과를 얻습니다.
+  struct InterproceduralDependencyModuleCheckPass : public ModulePass
+  {
+    static char ID;
+
+    DependencyAnalysis analysis;
+
+    InterproceduralDependencyModuleCheckPass()
+      : ModulePass(ID)
     {
-      out() << "Function - " << target_function->getName() << "\n";
     }
 
-    void printTargetFunctionAnnotatedVariable(DependencyManager *DM)
+    void getAnalysisUsage(AnalysisUsage &AU) const override
     {
-      DependencyManager::AnnotatedVector vec = DM->getAnnotatedVariableList();
-      increaseTab();
-      if (vec.size() == 0)
-      {
-        out() << "Annotated Variable is not found.\n\n";
-        decreaseTab();
-        return;
-      }
-      out() << "Annotated Variable List :\n";
-      increaseTab();
-      for (DependencyManager::AnnotatedTuple& tu : vec)
-      {
-        StringRef message = DM->getAnnotatedMessage(std::get<1>(tu));
-        out() << "- Annotated : " << std::get<0>(tu)->getName() << "(message: " << message << ")\n";
-      }
-      out() << "\n";
-      decreaseTab();
-      decreaseTab();
+      AU.addRequired<CallGraphWrapperPass>();
+      AU.setPreservesAll();
     }
 
-    void printTargetFunctionDependencyInstruction()
+    bool runOnModule(Module &M) override
     {
-      FunctionDependency *dependency = annotated_map->getDependency(target_function);
-      InstructionDependencyMap *inst_map = dependency->getInstrctionDependencyMap();
-      
-      increaseTab();
-      for (auto element : *inst_map)
-      {
-        out() << "Annotated-Variable : " << element.first->getName() << "\n";
-        increaseTab();
-        InstructionDependency *inst_dependency = element.second;
-        for (auto inst : *inst_dependency)
-        {
-          out() << (inst.second ? "(Perpect)" : "(Maybe)") << *inst.first << "\n";
-        }
-        out() << "\n";
-        decreaseTab();
-      }
-      decreaseTab();
+      analysis.runOnCallGraph(getAnalysis<CallGraphWrapperPass>().getCallGraph());
+      if (IDCLookupBenchmark)
+        analysis.benchmarkLookups(M, IDCLookupBenchmark);
+      bool changed = false;
+      for (Function& function : M)
+        if (!function.isDeclaration())
+          changed |= analysis.runOnFunction(&function);
+      analysis.exportResults(M);
+      analysis.saveIncrementalState(M);
+      return changed;
     }
 
-  private:
+  };
 
-    void increaseTab()
+  /// [정보]
+  /// 모든 함수의 slice를 계산한 뒤, slice에 속한 Instruction에 fault-injection
+  /// hook을 넣는 Pass입니다. 결과 프로그램은 Runtime/IDCInject.c와 함께
+  /// 링크해야 합니다.
+  ///
+  /// [보충]
+  /// -idc-slice-output, -idc-site-ranking이 주어지면 hook을 넣기 전의 slice를
+  /// 내보냅니다.
+  /// idc-campaign은 이 파일로 실험할 site를 정합니다.
+  struct InterproceduralDependencyInjectPass : public ModulePass
+  {
+    static char ID;
+
+    DependencyAnalysis analysis;
+
+    InterproceduralDependencyInjectPass()
+      : ModulePass(ID)
     {
-      tab += "    ";
     }
-    void decreaseTab()
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override
     {
-      tab.erase(0, 4);
+      AU.addRequired<CallGraphWrapperPass>();
     }
 
-    raw_ostream& out()
+    bool runOnModule(Module &M) override
     {
-      return errs() << tab;
+      analysis.runOnCallGraph(getAnalysis<CallGraphWrapperPass>().getCallGraph());
+      if (!IDCSliceOutput.empty() || !IDCSiteRanking.empty()) {
+        analysis.analyzeAll(M);
+        analysis.exportResults(M);
+      }
+      return analysis.instrument(M);
     }
 
   };
 
   ///---------------------------------------------------------
   ///
-  ///       Interprocedural Dependency Checker Pass
+  ///       New Pass Manager
   ///
   ///---------------------------------------------------------
 
-  struct InterproceduralDependencyCheckPass : public FunctionPass 
+  /// [정보]
+  /// IDCAnalysis의 결과입니다. 모듈의 함수 요약정보와 각 함수의 slice를
+  /// 가지고 있으며, 분석 결과를 쓰는 다른 pass가 다시 계산하지 않고
+  /// ModuleAnalysisManager에 캐시된 결과를 가져다 쓸 수 있습니다.
+  ///
+  /// [보충]
+  /// IR을 바꾼 pass가 IDCAnalysis를 보존한다고 알리지 않으면 기본 규칙에
+  /// 따라 무효화되고, 다음 요청에서 다시 계산됩니다.
+  class IDCAnalysisResult
   {
-    static char ID;
-    
-    DependencyMap *dependency_map;
-    DependencyMap *annotated_map;
-    std::map<Function *, DependencyManager *> function_map;
+    std::unique_ptr<DependencyAnalysis> analysis;
 
-    InterproceduralDependencyCheckPass()
-      : FunctionPass(ID)
+  public:
+
+    explicit IDCAnalysisResult(std::unique_ptr<DependencyAnalysis> Analysis)
+      : analysis(std::move(Analysis))
     {
-      initializeInterproceduralDependencyCheckPass(*PassRegistry::getPassRegistry());
-      dependency_map = new DependencyMap();
-      annotated_map = new DependencyMap();
     }
 
-    ~InterproceduralDependencyCheckPass()
+    bool isAnalyzed(const Function& F) const { return analysis->isAnalyzed(&F); }
+    FunctionDependency *getSummary(const Function& F) const { return analysis->getSummary(&F); }
+    FunctionDependency *getSlices(const Function& F) const { return analysis->getSlices(&F); }
+
+    /// I가 A의 slice에 속하는지 확인합니다. -idc-lazy-slices에서는 필요한
+    /// 만큼만 탐색합니다. 여러 스레드에서 동시에 호출할 수 없습니다.
+    bool isInSlice(Value *A, Instruction& I, bool Perpect = false) const
     {
-      delete dependency_map;
+      return analysis->isInSlice(A, &I, Perpect);
     }
 
-    bool runOnFunction(Function &F) override
+    void print(Function& F) const { analysis->print(&F); }
+    bool mark(Function& F) const { return analysis->check(&F); }
+    void exportSlices(Module& M, StringRef Path) const { analysis->exportSlices(M, Path); }
+    void exportResults(Module& M) const { analysis->exportResults(M); }
+
+    /// fault-injection hook을 넣습니다. 이 결과는 더 이상 IR과 맞지 않습니다.
+    void analyzeAll(Module& M) const { analysis->analyzeAll(M); }
+    bool instrument(Module& M) const { return analysis->instrument(M); }
+  };
+
+  /// [정보]
+  /// 모듈 전체의 함수 요약정보를 CallGraph의 SCC 순서로 계산하고, 정의된
+  /// 모든 함수의 annotated variable에 대한 slice를 계산하는 분석입니다.
+  /// -idc-threads, -idc-summary-cache, -idc-incremental 옵션을 legacy pass와
+  /// 같이 따릅니다.
+  /// -idc-lazy-slices에서는 요약정보만 계산하고, slice는 isInSlice가 호출될
+  /// 때 필요한 만큼만 계산합니다. 이때 print<idc>와 idc-mark는 slice를 계산한
+  /// 함수가 없으므로 아무것도 하지 않고, verify<idc>가 isInSlice를 사용합니다.
+  class IDCAnalysis : public AnalysisInfoMixin<IDCAnalysis>
+  {
+    friend AnalysisInfoMixin<IDCAnalysis>;
+    static AnalysisKey Key;
+
+  public:
+
+    using Result = IDCAnalysisResult;
+
+    Result run(Module &M, ModuleAnalysisManager &AM)
     {
-      DependencyManager *dm = new DependencyManager(&F, dependency_map, annotated_map);
-      dm->run();
-      function_map[&F] = dm;
-#if IDC_PRINT_RESULT
-      print(&F);
-#endif
-      check(&F);
-      return false;
+      auto analysis = std::make_unique<DependencyAnalysis>();
+      analysis->runOnCallGraph(AM.getResult<CallGraphAnalysis>(M));
+      if (!IDCLazySlices)
+        for (Function& function : M)
+          if (!function.isDeclaration())
+            analysis->analyze(&function);
+      analysis->saveIncrementalState(M);
+      return IDCAnalysisResult(std::move(analysis));
     }
+  };
 
-    void print(Function *F)
-    {
-      DependencyPrinter printer(annotated_map);
-      printer.setTargetFunction(F);
+  AnalysisKey IDCAnalysis::Key;
 
-      printer.printTargetFunctionName();
-      printer.printTargetFunctionAnnotatedVariable(function_map[F]);
-      printer.printTargetFunctionDependencyInstruction();
+  /// IDCAnalysis의 결과를 출력합니다. (print<idc>)
+  struct IDCPrinterPass : public PassInfoMixin<IDCPrinterPass>
+  {
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM)
+    {
+      IDCAnalysisResult& result = AM.getResult<IDCAnalysis>(M);
+      for (Function& function : M)
+        if (result.isAnalyzed(function))
+          result.print(function);
+      return PreservedAnalyses::all();
     }
+  };
 
-    void check(Function *F)
+  /// [정보]
+  /// IDCAnalysis의 isInSlice가 slice를 미리 계산했을 때와 같은 답을 내는지
+  /// 확인합니다. (verify<idc>) -idc-lazy-slices와 함께 쓰면 SliceQuery를
+  /// 검사합니다.
+  ///
+  /// [보충]
+  /// - 별도의 DependencyAnalysis로 모든 함수의 slice를 계산한 뒤, 각
+  ///   annotated variable과 함수의 모든 Instruction에 대해 Perpect와 Maybe를
+  ///   모두 물어 봅니다.
+  /// - 다른 답이 있으면 그 Instruction들을 출력하고 report_fatal_error로
+  ///   멈춥니다.
+  struct IDCVerifierPass : public PassInfoMixin<IDCVerifierPass>
+  {
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM)
     {
-      FunctionDependency *dependency = annotated_map->getDependency(F);
-      InstructionDependencyMap *inst_map = dependency->getInstrctionDependencyMap();
-      for (auto& element : *inst_map)
-      {
-        InstructionDependency *inst_dependency = element.second;
-        for (auto& inst : *inst_dependency)
-        {
-          ((Value *)(inst.first))->setDependency();
-          if (inst.second)
-            ((Value *)(inst.second))->setMaybeDependency();
-        }
+      IDCAnalysisResult& result = AM.getResult<IDCAnalysis>(M);
+      DependencyAnalysis eager;
+      eager.runOnCallGraph(AM.getResult<CallGraphAnalysis>(M));
+
+      unsigned mismatches = 0;
+      for (Function& function : M) {
+        if (function.isDeclaration())
+          continue;
+        eager.analyze(&function);
+        FunctionDependency *slices = eager.getSlices(&function);
+        if (!slices)
+          continue;
+        for (auto& element : *slices->getInstrctionDependencyMap())
+          for (BasicBlock& basic_block : function)
+            for (Instruction& inst : basic_block)
+              for (bool perpect : { true, false }) {
+                bool expected = element.second->hasInstructoin(&inst, perpect);
+                if (result.isInSlice(element.first, inst, perpect) == expected)
+                  continue;
+                errs() << "isInSlice(" << element.first->getName() << ", "
+                  << (perpect ? "Perpect" : "Maybe") << ") in " << function.getName()
+                  << " should be " << (expected ? "true" : "false") << ":" << inst << "\n";
+                mismatches++;
+              }
       }
+      if (mismatches)
+        report_fatal_error("isInSlice disagrees with the slices in " + Twine(mismatches) + " queries");
+      return PreservedAnalyses::all();
+    }
+  };
+
+  /// [정보]
+  /// IDCAnalysis의 결과를 !idc.dep, !idc.maybe metadata로 표시하고,
+  /// -idc-slice-output, -idc-site-ranking이 주어지면 slice를 내보냅니다.
+  /// (idc-mark)
+  ///
+  /// [보충]
+  /// metadata만 붙이므로 IDCAnalysis와 CFG 분석들은 보존됩니다.
+  struct IDCMarkPass : public PassInfoMixin<IDCMarkPass>
+  {
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM)
+    {
+      IDCAnalysisResult& result = AM.getResult<IDCAnalysis>(M);
+      bool changed = false;
+      for (Function& function : M)
+        if (result.isAnalyzed(function))
+          changed |= result.mark(function);
+      result.exportResults(M);
+
+      if (!changed)
+        return PreservedAnalyses::all();
+      PreservedAnalyses PA;
+      PA.preserve<IDCAnalysis>();
+      PA.preserveSet<CFGAnalyses>();
+      return PA;
     }
+  };
 
+  /// [정보]
+  /// IDCAnalysis의 slice에 속한 Instruction에 fault-injection hook을 넣습니다.
+  /// (idc-inject) 결과 프로그램은 Runtime/IDCInject.c와 함께 링크해야 합니다.
+  ///
+  /// [보충]
+  /// 블록을 나누므로 IDCAnalysis를 포함한 어떤 분석도 보존되지 않습니다.
+  /// -idc-slice-output, -idc-site-ranking은 hook을 넣기 전에 내보냅니다.
+  struct IDCInjectPass : public PassInfoMixin<IDCInjectPass>
+  {
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM)
+    {
+      IDCAnalysisResult& result = AM.getResult<IDCAnalysis>(M);
+      if (!IDCSliceOutput.empty() || !IDCSiteRanking.empty()) {
+        result.analyzeAll(M);
+        result.exportResults(M);
+      }
+      if (!result.instrument(M))
+        return PreservedAnalyses::all();
+      return PreservedAnalyses::none();
+    }
   };
 
 }
 
+/// [정보]
+/// opt -load-pass-plugin으로 불러올 때 IDCAnalysis와 print<idc>, verify<idc>,
+/// idc-mark, idc-inject pass를 등록합니다. require<idc>, invalidate<idc>도
+/// 사용할 수 있습니다.
+///
+/// [보충]
+/// opt는 명령줄을 모두 해석한 뒤에 -load-pass-plugin의 plugin을 불러오므로,
+/// 그것만으로는 -idc-* 옵션이 알 수 없는 옵션으로 거부됩니다. 옵션은 -load로
+/// 불러올 때 등록되므로 같은 파일을 두 번 지정합니다. -idc-* 옵션을 쓰지
+/// 않는다면 -load-pass-plugin만으로 충분합니다.
+///
+///   opt -load LLVMCustom.so -load-pass-plugin LLVMCustom.so
+///       -idc-lazy-slices -passes='print<idc>' a.ll
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo()
+{
+  return { LLVM_PLUGIN_API_VERSION, "InterproceduralDependencyCheck", LLVM_VERSION_STRING,
+    [](PassBuilder &PB) {
+      PB.registerAnalysisRegistrationCallback(
+        [](ModuleAnalysisManager &MAM) {
+          MAM.registerPass([] { return IDCAnalysis(); });
+        });
+      PB.registerPipelineParsingCallback(
+        [](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+          if (Name == "print<idc>") {
+            MPM.addPass(IDCPrinterPass());
+            return true;
+          }
+          if (Name == "verify<idc>") {
+            MPM.addPass(IDCVerifierPass());
+            return true;
+          }
+          if (Name == "idc-mark") {
+            MPM.addPass(IDCMarkPass());
+            return true;
+          }
+          if (Name == "idc-inject") {
+            MPM.addPass(IDCInjectPass());
+            return true;
+          }
+          return parseAnalysisUtilityPasses<IDCAnalysis>("idc", Name, MPM);
+        });
+    } };
+}
+
 char InterproceduralDependencyCheckPass::ID = 0;
 static RegisterPass<InterproceduralDependencyCheckPass> X("dependency", "DependencyPass");
 
-INITIALIZE_PASS_BEGIN(InterproceduralDependencyCheckPass, "dependency",
-  "Dependency Check and Marking Pass", false, false)
-INITIALIZE_PASS_END(InterproceduralDependencyCheckPass, "dependency",
-    "Dependency Check and Marking Pass", false, false)
+char InterproceduralDependencyModuleCheckPass::ID = 0;
+static RegisterPass<InterproceduralDependencyModuleCheckPass> Y("dependency-module",
+  "Module Dependency Pass");
 
-FunctionPass *llvm::createInterproceduralDependencyCheckPass() {
-  return new InterproceduralDependencyCheckPass();
-}
\ No newline at end of file
+char InterproceduralDependencyInjectPass::ID = 0;
+static RegisterPass<InterproceduralDependencyInjectPass> Z("dependency-inject",
+  "Slice Fault Injection Pass");
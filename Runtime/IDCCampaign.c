@@ -0,0 +1,844 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  idc-campaign: runs a fault-injection campaign over the slice sites.
+//
+//    idc-campaign [options] <slice file> -- <program> [arguments...]
+//
+//    -j <jobs>     number of sites run at the same time (default: CPUs)
+//    -t <ms>       timeout of one run (default: 10 x golden run, >= 1000)
+//    -n <count>    dynamic instances per site, 1..count (default 1)
+//    -b <count>    bits per instance, 0..count-1 (default 32)
+//    -m            also inject into Maybe sites
+//    -a            inject into every site, not only the representatives
+//    -r <file>     weight the sites by a site ranking (-idc-site-ranking)
+//    -s <count>    run count sampled experiments instead of all of them
+//    -S <seed>     seed of the sampling (default 1)
+//    -o <file>     result log (default idc-campaign.log)
+//
+//  The slice file is written by the dependency pass with -idc-slice-output
+//  and the program must be instrumented by the same pass (-dependency-inject
+//  or idc-inject) and linked with the IDCInject runtime. Only the sites in the
+//  slices that the instrumenter hooks are scheduled: Perpect sites, and Maybe
+//  sites with -m. Note that the pass instruments Maybe sites only with
+//  -idc-inject-maybe.
+//
+//  By default only the representative of each fault-equivalence class
+//  (IDCSlice.h) is injected, and its results count as many times as the
+//  weight of the class. The summary shows both the runs and the weighted
+//  results; with -a every site is run with weight 1.
+//
+//  With -r the weight of a site is its score in the ranking written by the
+//  dependency pass with -idc-site-ranking, that is its estimated execution
+//  count times the weight of its class (or the execution count alone with
+//  -a). The results then estimate the outcome of a fault that strikes a
+//  random dynamic instruction of the slices.
+//
+//  With -s, count experiments are drawn instead: a site in proportion to its
+//  weight, then an instance from 1..-n and a bit from 0..-b-1. Each drawn
+//  experiment has weight 1, and an experiment drawn twice runs once. The
+//  draw only depends on the seed, so a sampled campaign resumes like a full
+//  one.
+//
+//  The program first runs once without a fault (the golden run). Each site
+//  then gets a fork server (IDCInject.h) and every (instance, bit) of the
+//  site is run as a child of it, so the program runs up to the site only
+//  once per site. Every run is classified against the golden run:
+//
+//    masked     same exit status and same standard output
+//    sdc        exited, but the exit status or the output differs
+//    crash      killed by a signal
+//    hang       killed after the timeout
+//    unreached  the instance was never executed, so no fault was injected
+//
+//  Once an instance is unreached, the later instances of the site are
+//  recorded as unreached without running them. The program is assumed to be
+//  deterministic and its standard input is /dev/null.
+//
+//  Each result is appended to the log as one line
+//
+//    <site id in hex> <instance> <bit> <outcome> <wait status>
+//
+//  as soon as the run ends. When the campaign is started again with the same
+//  log, the experiments already in the log are skipped.
+//
+//===----------------------------------------------------------------------===//
+
+#define _GNU_SOURCE
+
+#include "IDCInject.h"
+#include "IDCSlice.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+enum outcome { MASKED, SDC, CRASH, HANG, UNREACHED, OUTCOME_COUNT };
+
+static const char *const outcome_names[OUTCOME_COUNT] = {
+    "masked", "sdc", "crash", "hang", "unreached"};
+
+struct trial {
+  uint64_t instance;
+  uint32_t bit;
+};
+
+struct site {
+  uint64_t id;
+  double weight;
+  // The drawn experiments with -s, sorted by instance. NULL runs every
+  // (instance, bit).
+  struct trial *trials;
+  size_t trial_count;
+};
+
+struct experiment {
+  uint64_t site;
+  uint64_t instance;
+  uint32_t bit;
+};
+
+enum worker_state { W_IDLE, W_STARTING, W_RUNNING };
+
+struct worker {
+  enum worker_state state;
+  pid_t server;
+  int control, status, output;
+  uint64_t site;
+  // Output the server wrote before it reached the site. Every child starts
+  // after it.
+  char *prefix;
+  size_t prefix_size;
+  // The next (instance, bit) of the site and the instance found unreached.
+  const struct site *current;
+  size_t trial;
+  uint64_t instance;
+  uint32_t bit;
+  uint64_t unreached_from;
+  // The running child.
+  pid_t child;
+  off_t run_begin;
+  double deadline;
+  int killed;
+};
+
+static char **program;
+static int jobs;
+static double timeout;
+static uint64_t instances = 1;
+static uint32_t bits = 32;
+static int include_maybe;
+static int all_sites;
+static const char *ranking_path;
+static uint64_t samples;
+static uint64_t seed = 1;
+static const char *log_path = "idc-campaign.log";
+
+static struct site *sites;
+static size_t site_count;
+
+static int log_fd = -1;
+static struct experiment *done;
+static size_t done_count;
+static uint64_t counts[OUTCOME_COUNT];
+static double weighted[OUTCOME_COUNT];
+static uint64_t skipped;
+
+static int golden_status;
+static char *golden_output;
+static size_t golden_size;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fail(const char *message) {
+  perror(message);
+  exit(1);
+}
+
+static int compare_experiment(const void *left, const void *right) {
+  const struct experiment *a = (const struct experiment *)left;
+  const struct experiment *b = (const struct experiment *)right;
+  if (a->site != b->site)
+    return a->site < b->site ? -1 : 1;
+  if (a->instance != b->instance)
+    return a->instance < b->instance ? -1 : 1;
+  if (a->bit != b->bit)
+    return a->bit < b->bit ? -1 : 1;
+  return 0;
+}
+
+static int compare_site(const void *left, const void *right) {
+  uint64_t a = ((const struct site *)left)->id, b = ((const struct site *)right)->id;
+  return a < b ? -1 : a > b;
+}
+
+/// Returns the scheduled site with the given id, or NULL if it is not
+/// scheduled. The sites are sorted by id.
+static struct site *find_site(uint64_t id) {
+  struct site key;
+  key.id = id;
+  return (struct site *)bsearch(&key, sites, site_count, sizeof(*sites),
+                                compare_site);
+}
+
+/// Weight of a scheduled site, or 0 for a site that is not scheduled.
+static double site_weight(uint64_t id) {
+  const struct site *site = find_site(id);
+  return site ? site->weight : 0;
+}
+
+//===----------------------------------------------------------------------===//
+//
+//                                Result Log
+//
+//===----------------------------------------------------------------------===//
+
+static void load_log(void) {
+  size_t capacity = 0;
+  char line[256], name[16];
+  struct experiment e;
+  int status, last = '\n', c, i;
+  FILE *file = fopen(log_path, "r");
+
+  if (file) {
+    while (fgets(line, sizeof(line), file)) {
+      if (sscanf(line, "%" SCNx64 " %" SCNu64 " %" SCNu32 " %15s %d", &e.site,
+                 &e.instance, &e.bit, name, &status) != 5 ||
+          !strchr(line, '\n'))
+        continue;
+      for (i = 0; i < OUTCOME_COUNT; i++)
+        if (!strcmp(name, outcome_names[i]))
+          break;
+      if (i == OUTCOME_COUNT)
+        continue;
+      if (done_count == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        done = (struct experiment *)realloc(done, capacity * sizeof(*done));
+        if (!done)
+          fail("realloc");
+      }
+      done[done_count++] = e;
+      counts[i]++;
+      weighted[i] += site_weight(e.site);
+    }
+    // A run that was interrupted while writing leaves a partial line.
+    if (fseek(file, -1, SEEK_END) == 0 && (c = fgetc(file)) != EOF)
+      last = c;
+    fclose(file);
+  }
+  qsort(done, done_count, sizeof(*done), compare_experiment);
+
+  log_fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (log_fd < 0)
+    fail(log_path);
+  if (last != '\n' && write(log_fd, "\n", 1) != 1)
+    fail(log_path);
+}
+
+static int is_done(uint64_t site, uint64_t instance, uint32_t bit) {
+  struct experiment e = {site, instance, bit};
+  return bsearch(&e, done, done_count, sizeof(*done), compare_experiment) != NULL;
+}
+
+static void record(uint64_t site, uint64_t instance, uint32_t bit,
+                   enum outcome outcome, int status) {
+  char line[128];
+  int size = snprintf(line, sizeof(line), "%" PRIx64 " %" PRIu64 " %" PRIu32
+                      " %s %d\n", site, instance, bit, outcome_names[outcome],
+                      status);
+  // One write per line, so a line is never split by an interruption other
+  // than at its end.
+  if (write(log_fd, line, (size_t)size) != size)
+    fail(log_path);
+  counts[outcome]++;
+  weighted[outcome] += site_weight(site);
+}
+
+//===----------------------------------------------------------------------===//
+//
+//                                 Programs
+//
+//===----------------------------------------------------------------------===//
+
+static char *read_range(int fd, off_t begin, off_t end, size_t *size) {
+  char *buffer = (char *)malloc(end > begin ? (size_t)(end - begin) : 1);
+  ssize_t n;
+
+  *size = 0;
+  if (!buffer)
+    fail("malloc");
+  while (begin + (off_t)*size < end) {
+    n = pread(fd, buffer + *size, (size_t)(end - begin) - *size,
+              begin + (off_t)*size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    *size += (size_t)n;
+  }
+  return buffer;
+}
+
+static off_t file_size(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    fail("fstat");
+  return st.st_size;
+}
+
+static int make_output(void) {
+  char path[] = "/tmp/idc-campaign-XXXXXX";
+  int fd = mkostemp(path, O_CLOEXEC);
+  if (fd < 0)
+    fail("mkstemp");
+  unlink(path);
+  return fd;
+}
+
+/// Starts the program with standard output on output. control and status
+/// are the ends the program gets for the fork server, or -1.
+static pid_t spawn(int output, int control, int status, const char *site) {
+  pid_t pid = fork();
+  int null;
+
+  if (pid < 0)
+    fail("fork");
+  if (pid != 0)
+    return pid;
+
+  null = open("/dev/null", O_RDWR);
+  dup2(null, 0);
+  dup2(null, 2);
+  dup2(output, 1);
+  if (control >= 0) {
+    dup2(control, IDC_FORKSRV_FD);
+    dup2(status, IDC_FORKSRV_FD + 1);
+    setenv("IDC_INJECT_SITE", site, 1);
+    setenv("IDC_INJECT_FORKSERVER", "1", 1);
+  }
+  execvp(program[0], program);
+  _exit(127);
+}
+
+static void run_golden(void) {
+  int output = make_output(), status;
+  double start = now();
+  pid_t pid = spawn(output, -1, -1, NULL);
+
+  while (waitpid(pid, &status, 0) < 0)
+    if (errno != EINTR)
+      fail("waitpid");
+  if (timeout <= 0) {
+    timeout = (now() - start) * 10;
+    if (timeout < 1)
+      timeout = 1;
+  }
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+    fprintf(stderr, "idc-campaign: cannot run %s\n", program[0]);
+    exit(1);
+  }
+  golden_status = status;
+  golden_output = read_range(output, 0, file_size(output), &golden_size);
+  close(output);
+}
+
+static enum outcome classify(int status, int killed, const char *output,
+                             size_t size) {
+  if (killed)
+    return HANG;
+  if (WIFSIGNALED(status))
+    return CRASH;
+  if (status != golden_status || size != golden_size ||
+      memcmp(output, golden_output, size) != 0)
+    return SDC;
+  return MASKED;
+}
+
+//===----------------------------------------------------------------------===//
+//
+//                                 Workers
+//
+//===----------------------------------------------------------------------===//
+
+static int read_word(int fd, uint32_t *word) {
+  char *p = (char *)word;
+  size_t size = sizeof(*word);
+  ssize_t n;
+
+  while (size) {
+    n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    size -= (size_t)n;
+  }
+  return 1;
+}
+
+static void stop_server(struct worker *w) {
+  if (w->control >= 0)
+    close(w->control);
+  if (w->status >= 0)
+    close(w->status);
+  w->control = w->status = -1;
+  if (w->server > 0) {
+    kill(w->server, SIGKILL);
+    while (waitpid(w->server, NULL, 0) < 0 && errno == EINTR)
+      ;
+  }
+  w->server = 0;
+  free(w->prefix);
+  w->prefix = NULL;
+  w->state = W_IDLE;
+}
+
+/// Moves to the next (instance, bit) of the site that is not in the log.
+/// Returns 0 when the site is finished.
+static int next_experiment(struct worker *w) {
+  if (w->current->trials) {
+    for (; w->trial < w->current->trial_count; w->trial++) {
+      w->instance = w->current->trials[w->trial].instance;
+      w->bit = w->current->trials[w->trial].bit;
+      if (is_done(w->site, w->instance, w->bit)) {
+        skipped++;
+        continue;
+      }
+      if (w->instance < w->unreached_from)
+        return 1;
+      record(w->site, w->instance, w->bit, UNREACHED, 0);
+    }
+    return 0;
+  }
+
+  for (; w->instance <= instances; w->instance++, w->bit = 0) {
+    for (; w->bit < bits; w->bit++) {
+      if (is_done(w->site, w->instance, w->bit)) {
+        skipped++;
+        continue;
+      }
+      if (w->instance < w->unreached_from)
+        return 1;
+      record(w->site, w->instance, w->bit, UNREACHED, 0);
+    }
+  }
+  return 0;
+}
+
+static void start_site(struct worker *w, const struct site *site) {
+  char text[32];
+  int control[2], status[2];
+
+  w->current = site;
+  w->site = site->id;
+  w->trial = 0;
+  w->instance = 1;
+  w->bit = 0;
+  w->unreached_from = UINT64_MAX;
+  if (!next_experiment(w))
+    return;
+
+  // dup2 in spawn clears O_CLOEXEC on the ends the server uses.
+  if (pipe2(control, O_CLOEXEC) != 0 || pipe2(status, O_CLOEXEC) != 0)
+    fail("pipe");
+  if (ftruncate(w->output, 0) != 0)
+    fail("ftruncate");
+  lseek(w->output, 0, SEEK_SET);
+  snprintf(text, sizeof(text), "%" PRIu64, site->id);
+  w->server = spawn(w->output, control[0], status[1], text);
+  close(control[0]);
+  close(status[1]);
+  w->control = control[1];
+  w->status = status[0];
+  w->state = W_STARTING;
+  w->deadline = now() + timeout;
+}
+
+static void send_request(struct worker *w) {
+  struct idc_forksrv_request request;
+  uint32_t pid;
+
+  memset(&request, 0, sizeof(request));
+  request.instance = w->instance;
+  request.bit = w->bit;
+  w->run_begin = file_size(w->output);
+  if (write(w->control, &request, sizeof(request)) != sizeof(request) ||
+      !read_word(w->status, &pid)) {
+    // The server is gone. Treat the rest of the site as unreached rather
+    // than retrying it forever.
+    w->unreached_from = w->instance;
+    next_experiment(w);
+    stop_server(w);
+    return;
+  }
+  w->child = (pid_t)pid;
+  w->killed = 0;
+  w->deadline = now() + timeout;
+  w->state = W_RUNNING;
+}
+
+static void finish_run(struct worker *w) {
+  uint32_t status, fired;
+  char *output, *run;
+  size_t run_size;
+
+  if (!read_word(w->status, &status) || !read_word(w->status, &fired)) {
+    w->unreached_from = w->instance;
+    next_experiment(w);
+    stop_server(w);
+    return;
+  }
+
+  if (!fired && !w->killed) {
+    w->unreached_from = w->instance;
+    record(w->site, w->instance, w->bit, UNREACHED, (int)status);
+  } else {
+    run = read_range(w->output, w->run_begin, file_size(w->output), &run_size);
+    output = (char *)malloc(w->prefix_size + run_size + 1);
+    if (!output)
+      fail("malloc");
+    memcpy(output, w->prefix, w->prefix_size);
+    memcpy(output + w->prefix_size, run, run_size);
+    record(w->site, w->instance, w->bit,
+           classify((int)status, w->killed, output, w->prefix_size + run_size),
+           (int)status);
+    free(output);
+    free(run);
+  }
+
+  if (w->current->trials)
+    w->trial++;
+  else
+    w->bit++;
+  if (next_experiment(w))
+    send_request(w);
+  else
+    stop_server(w);
+}
+
+static void handle_hello(struct worker *w) {
+  uint32_t hello;
+
+  if (!read_word(w->status, &hello) || hello != IDC_FORKSRV_HELLO) {
+    // The program ended without reaching the site.
+    w->unreached_from = 1;
+    next_experiment(w);
+    stop_server(w);
+    return;
+  }
+  w->prefix = read_range(w->output, 0, file_size(w->output), &w->prefix_size);
+  send_request(w);
+}
+
+static void handle_timeout(struct worker *w) {
+  if (w->state == W_STARTING) {
+    w->unreached_from = 1;
+    next_experiment(w);
+    stop_server(w);
+  } else if (!w->killed) {
+    kill(w->child, SIGKILL);
+    w->killed = 1;
+    w->deadline = now() + timeout;
+  }
+}
+
+static void run_campaign(void) {
+  struct worker *workers = (struct worker *)calloc((size_t)jobs, sizeof(*workers));
+  struct pollfd *fds = (struct pollfd *)calloc((size_t)jobs, sizeof(*fds));
+  size_t next_site = 0;
+  int i, active, wait;
+  double t, earliest;
+
+  if (!workers || !fds)
+    fail("calloc");
+  for (i = 0; i < jobs; i++) {
+    workers[i].output = make_output();
+    workers[i].control = workers[i].status = -1;
+  }
+
+  for (;;) {
+    for (i = 0; i < jobs; i++)
+      while (workers[i].state == W_IDLE && next_site < site_count)
+        start_site(&workers[i], &sites[next_site++]);
+
+    active = 0;
+    earliest = 0;
+    for (i = 0; i < jobs; i++) {
+      fds[i].fd = workers[i].state == W_IDLE ? -1 : workers[i].status;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+      if (workers[i].state == W_IDLE)
+        continue;
+      if (!active || workers[i].deadline < earliest)
+        earliest = workers[i].deadline;
+      active++;
+    }
+    if (!active)
+      break;
+
+    t = now();
+    wait = earliest > t ? (int)((earliest - t) * 1000) + 1 : 0;
+    if (poll(fds, (nfds_t)jobs, wait) < 0 && errno != EINTR)
+      fail("poll");
+
+    t = now();
+    for (i = 0; i < jobs; i++) {
+      struct worker *w = &workers[i];
+      if (w->state == W_IDLE)
+        continue;
+      if (fds[i].revents) {
+        if (w->state == W_STARTING)
+          handle_hello(w);
+        else
+          finish_run(w);
+      } else if (t >= w->deadline) {
+        handle_timeout(w);
+      }
+    }
+  }
+
+  for (i = 0; i < jobs; i++)
+    close(workers[i].output);
+  free(workers);
+  free(fds);
+}
+
+//===----------------------------------------------------------------------===//
+//
+//                                   Main
+//
+//===----------------------------------------------------------------------===//
+
+static void collect_sites(const struct idc_slice_file *file) {
+  const struct idc_slice_header *header = file->header;
+  uint32_t i, j;
+  size_t n = 0, k;
+
+  sites = (struct site *)malloc((header->site_count + 1) * sizeof(*sites));
+  if (!sites)
+    fail("malloc");
+  for (i = 0; i < header->variable_count; i++) {
+    const struct idc_slice_variable *variable = &file->variables[i];
+    for (j = 0; j < variable->site_count; j++) {
+      const struct idc_slice_site *site = &file->sites[variable->site_begin + j];
+      // The instrumenter never hooks these, so a run would not reach them.
+      if (!(site->flags & IDC_SITE_INJECTABLE))
+        continue;
+      if (!include_maybe && !(site->flags & IDC_SITE_PERFECT))
+        continue;
+      if (!all_sites && site->weight == 0)
+        continue;
+      memset(&sites[n], 0, sizeof(sites[n]));
+      sites[n].id = IDC_INJECT_SITE_ID(variable->function_id, site->instruction_id);
+      sites[n].weight = all_sites ? 1 : site->weight;
+      n++;
+    }
+  }
+
+  // A site in several slices is injected once.
+  qsort(sites, n, sizeof(*sites), compare_site);
+  for (k = 0, site_count = 0; k < n; k++)
+    if (site_count == 0 || sites[site_count - 1].id != sites[k].id)
+      sites[site_count++] = sites[k];
+}
+
+/// Replaces the weights of the sites with their ranking. A site missing from
+/// the ranking gets weight 0.
+static void load_ranking(void) {
+  char line[1024], kind;
+  uint64_t id;
+  double score, frequency;
+  unsigned weight;
+  size_t i;
+  struct site *site;
+  FILE *file = fopen(ranking_path, "r");
+
+  if (!file || !fgets(line, sizeof(line), file) || strncmp(line, "IDCRANK 1", 9)) {
+    fprintf(stderr, "idc-campaign: cannot read site ranking %s\n", ranking_path);
+    exit(1);
+  }
+  for (i = 0; i < site_count; i++)
+    sites[i].weight = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (sscanf(line, "%" SCNx64 " %lf %lf %u %c", &id, &score, &frequency,
+               &weight, &kind) != 5)
+      continue;
+    if ((site = find_site(id)))
+      site->weight = all_sites ? frequency : score;
+  }
+  fclose(file);
+}
+
+static uint64_t next_random(void) {
+  // xorshift64*
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return seed * 0x2545F4914F6CDD1DULL;
+}
+
+static int compare_trial(const void *left, const void *right) {
+  const struct trial *a = (const struct trial *)left;
+  const struct trial *b = (const struct trial *)right;
+  if (a->instance != b->instance)
+    return a->instance < b->instance ? -1 : 1;
+  return a->bit < b->bit ? -1 : a->bit > b->bit;
+}
+
+/// Draws the experiments of -s and leaves only the sites that got one.
+static void draw_samples(void) {
+  double *cumulative = (double *)malloc((site_count + 1) * sizeof(*cumulative));
+  size_t *capacity = (size_t *)calloc(site_count + 1, sizeof(*capacity));
+  double total = 0, target;
+  size_t i, n, low, high;
+  uint64_t k;
+
+  if (!cumulative || !capacity)
+    fail("malloc");
+  for (i = 0; i < site_count; i++)
+    cumulative[i] = total += sites[i].weight;
+  if (total <= 0) {
+    site_count = 0;
+    free(cumulative);
+    free(capacity);
+    return;
+  }
+  if (seed == 0)
+    seed = 1;
+
+  for (k = 0; k < samples; k++) {
+    struct site *site;
+    target = (double)(next_random() >> 11) / 9007199254740992.0 * total;
+    for (low = 0, high = site_count - 1; low < high;) {
+      size_t mid = low + (high - low) / 2;
+      if (cumulative[mid] <= target)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    site = &sites[low];
+    if (site->trial_count == capacity[low]) {
+      capacity[low] = capacity[low] ? capacity[low] * 2 : 4;
+      site->trials = (struct trial *)realloc(site->trials,
+                                             capacity[low] * sizeof(*site->trials));
+      if (!site->trials)
+        fail("realloc");
+    }
+    site->trials[site->trial_count].instance = 1 + next_random() % instances;
+    site->trials[site->trial_count].bit = (uint32_t)(next_random() % bits);
+    site->trial_count++;
+  }
+
+  for (i = 0, n = 0; i < site_count; i++) {
+    struct site *site = &sites[i];
+    size_t j, m;
+    if (!site->trial_count)
+      continue;
+    qsort(site->trials, site->trial_count, sizeof(*site->trials), compare_trial);
+    for (j = 0, m = 0; j < site->trial_count; j++)
+      if (m == 0 || compare_trial(&site->trials[m - 1], &site->trials[j]) != 0)
+        site->trials[m++] = site->trials[j];
+    site->trial_count = m;
+    site->weight = 1;
+    sites[n++] = *site;
+  }
+  site_count = n;
+  free(cumulative);
+  free(capacity);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: idc-campaign [-j jobs] [-t ms] [-n instances] [-b bits] [-m] [-a]\n"
+          "                    [-r ranking] [-s samples] [-S seed] [-o log]\n"
+          "                    <slice file> -- <program> [args...]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  struct idc_slice_file file;
+  uint64_t total = 0;
+  double weighted_total = 0;
+  int option, i;
+
+  while ((option = getopt(argc, argv, "j:t:n:b:mar:s:S:o:")) != -1) {
+    switch (option) {
+    case 'j': jobs = atoi(optarg); break;
+    case 't': timeout = atof(optarg) / 1000; break;
+    case 'n': instances = strtoull(optarg, NULL, 0); break;
+    case 'b': bits = (uint32_t)strtoul(optarg, NULL, 0); break;
+    case 'm': include_maybe = 1; break;
+    case 'a': all_sites = 1; break;
+    case 'r': ranking_path = optarg; break;
+    case 's': samples = strtoull(optarg, NULL, 0); break;
+    case 'S': seed = strtoull(optarg, NULL, 0); break;
+    case 'o': log_path = optarg; break;
+    default: usage();
+    }
+  }
+  if (optind + 1 >= argc || instances == 0 || bits == 0 || bits > 64)
+    usage();
+  program = &argv[optind + 1];
+  if (jobs <= 0)
+    jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (jobs <= 0)
+    jobs = 1;
+
+  if (idc_slice_open(argv[optind], &file) != 0) {
+    fprintf(stderr, "idc-campaign: cannot read slice file %s\n", argv[optind]);
+    return 1;
+  }
+  collect_sites(&file);
+  idc_slice_close(&file);
+  if (ranking_path)
+    load_ranking();
+  if (samples)
+    draw_samples();
+
+  signal(SIGPIPE, SIG_IGN);
+  unsetenv("IDC_INJECT_SITE");
+  unsetenv("IDC_INJECT_INSTANCE");
+  unsetenv("IDC_INJECT_BIT");
+  unsetenv("IDC_INJECT_FORKSERVER");
+
+  load_log();
+  run_golden();
+  run_campaign();
+
+  printf("%zu sites, %" PRIu64 " experiments already in %s\n", site_count,
+         skipped, log_path);
+  for (i = 0; i < OUTCOME_COUNT; i++) {
+    total += counts[i];
+    weighted_total += weighted[i];
+  }
+  printf("%-10s %12s %12s\n", "", "runs", "weighted %");
+  for (i = 0; i < OUTCOME_COUNT; i++)
+    printf("%-10s %12" PRIu64 " %12.2f\n", outcome_names[i], counts[i],
+           weighted_total > 0 ? weighted[i] * 100 / weighted_total : 0.0);
+  printf("%-10s %12" PRIu64 "\n", "total", total);
+  for (i = 0; i < (int)site_count; i++)
+    free(sites[i].trials);
+  free(sites);
+  return 0;
+}
@@ -0,0 +1,165 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IDCInject.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+uint64_t __idc_inject_site = IDC_INJECT_DISABLED;
+
+static uint64_t target_instance = 1;
+static uint64_t instance_count;
+static uint32_t target_bit;
+static int fired;
+static int forkserver;
+// Shared with the fork server so that it can report whether a child fired.
+static int *shared_fired;
+
+static uint64_t read_env(const char *name, uint64_t fallback) {
+  const char *text = getenv(name);
+  char *end;
+  uint64_t value;
+
+  if (!text || !*text)
+    return fallback;
+  value = strtoull(text, &end, 0);
+  return *end ? fallback : value;
+}
+
+__attribute__((constructor)) static void idc_inject_init(void) {
+  if (!getenv("IDC_INJECT_SITE"))
+    return;
+  idc_inject_arm(read_env("IDC_INJECT_SITE", IDC_INJECT_DISABLED),
+                 read_env("IDC_INJECT_INSTANCE", 1),
+                 (uint32_t)read_env("IDC_INJECT_BIT", 0));
+  forkserver = read_env("IDC_INJECT_FORKSERVER", 0) != 0;
+}
+
+static int read_all(int fd, void *buffer, size_t size) {
+  char *p = (char *)buffer;
+  ssize_t n;
+
+  while (size) {
+    n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    size -= (size_t)n;
+  }
+  return 1;
+}
+
+static int write_all(int fd, const void *buffer, size_t size) {
+  const char *p = (const char *)buffer;
+  ssize_t n;
+
+  while (size) {
+    n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    size -= (size_t)n;
+  }
+  return 1;
+}
+
+/// Returns in a forked child with its fault armed, or in the original
+/// process if there is no driver. The server itself never returns.
+static void run_forkserver(uint64_t site) {
+  const int control = IDC_FORKSRV_FD, status = IDC_FORKSRV_FD + 1;
+  uint32_t word = IDC_FORKSRV_HELLO;
+  struct idc_forksrv_request request;
+  int *child_fired;
+  pid_t pid;
+  int wstatus;
+
+  child_fired = (int *)mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (child_fired == MAP_FAILED)
+    return;
+  if (!write_all(status, &word, sizeof(word))) {
+    munmap(child_fired, sizeof(int));
+    return;
+  }
+
+  while (read_all(control, &request, sizeof(request))) {
+    *child_fired = 0;
+    pid = fork();
+    if (pid < 0)
+      _exit(1);
+    if (pid == 0) {
+      close(control);
+      close(status);
+      idc_inject_arm(site, request.instance, request.bit);
+      shared_fired = child_fired;
+      return;
+    }
+
+    word = (uint32_t)pid;
+    if (!write_all(status, &word, sizeof(word)))
+      break;
+    while (waitpid(pid, &wstatus, 0) < 0)
+      if (errno != EINTR)
+        _exit(1);
+    word = (uint32_t)wstatus;
+    if (!write_all(status, &word, sizeof(word)))
+      break;
+    word = (uint32_t)*child_fired;
+    if (!write_all(status, &word, sizeof(word)))
+      break;
+  }
+
+  // stdio buffers belong to the children.
+  _exit(0);
+}
+
+uint64_t __idc_inject(uint64_t site, uint64_t value, uint32_t bits) {
+  // Another thread may have fired the fault after this one passed the check
+  // in the instrumented code.
+  if (site != __atomic_load_n(&__idc_inject_site, __ATOMIC_RELAXED) || bits == 0)
+    return value;
+  if (forkserver) {
+    forkserver = 0;
+    run_forkserver(site);
+  }
+  if (__atomic_add_fetch(&instance_count, 1, __ATOMIC_RELAXED) != target_instance)
+    return value;
+
+  __atomic_store_n(&__idc_inject_site, IDC_INJECT_DISABLED, __ATOMIC_RELAXED);
+  fired = 1;
+  if (shared_fired)
+    *shared_fired = 1;
+  return value ^ ((uint64_t)1 << (target_bit % bits));
+}
+
+void idc_inject_arm(uint64_t site, uint64_t instance, uint32_t bit) {
+  target_instance = instance ? instance : 1;
+  target_bit = bit;
+  instance_count = 0;
+  fired = 0;
+  __atomic_store_n(&__idc_inject_site, site, __ATOMIC_RELAXED);
+}
+
+void idc_inject_disarm(void) {
+  __atomic_store_n(&__idc_inject_site, IDC_INJECT_DISABLED, __ATOMIC_RELAXED);
+}
+
+int idc_inject_fired(void) {
+  return fired;
+}
@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  Fault-injection runtime for programs instrumented by the dependency pass
+//  (-dependency-inject, idc-inject).
+//
+//  Every instrumented site compares its site id with __idc_inject_site and
+//  calls __idc_inject only when they are equal. With no fault armed a site
+//  costs one load, one compare and one never-taken branch.
+//
+//  A fault is armed from the environment when the program starts:
+//
+//    IDC_INJECT_SITE      site id, (function_id << 32) | instruction_id
+//    IDC_INJECT_INSTANCE  dynamic instance of the site to corrupt, counted
+//                         from 1 (default 1)
+//    IDC_INJECT_BIT       bit of the value to flip, taken modulo the width
+//                         of the value (default 0)
+//
+//  function_id and instruction_id are the same as in the slice file
+//  (IDCSlice.h). Numbers may be decimal or 0x-prefixed hexadecimal. Only one
+//  fault is injected per run; the site disarms itself once it fires.
+//
+//  Fork server
+//
+//  With IDC_INJECT_FORKSERVER=1 the program runs normally up to the first
+//  dynamic instance of IDC_INJECT_SITE and stops there. From that point a
+//  child is forked for every fault requested by the campaign driver, so the
+//  part of the program before the site runs only once per site instead of
+//  once per fault. The driver talks to the server over two pipes:
+//
+//    IDC_FORKSRV_FD      (control) the driver writes idc_forksrv_request
+//    IDC_FORKSRV_FD + 1  (status)  the server writes 32-bit words
+//
+//  When the site is reached the server writes IDC_FORKSRV_HELLO. For every
+//  request it writes the pid of the child, the wait status of the child and
+//  1 if the fault was injected or 0 if the instance was never reached. The
+//  driver may kill the child to enforce a timeout. The server
+//  exits when the control pipe is closed. If the status pipe is not open
+//  the fork server is disabled and the program runs as a normal armed run.
+//  If the program ends without the driver having received the hello, the
+//  site was not reached.
+//
+//  Children continue from the state of the server, including unflushed
+//  stdio buffers, and see the first instance as instance 1. Only the thread
+//  that reached the site exists in a child.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDC_INJECT_H
+#define IDC_INJECT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Value of __idc_inject_site while no fault is armed. No site has this id.
+#define IDC_INJECT_DISABLED UINT64_MAX
+
+#define IDC_INJECT_SITE_ID(function_id, instruction_id) \
+  (((uint64_t)(function_id) << 32) | (uint32_t)(instruction_id))
+
+#define IDC_FORKSRV_FD 198
+#define IDC_FORKSRV_HELLO 0x49444346u
+
+struct idc_forksrv_request {
+  uint64_t instance;
+  uint32_t bit;
+  uint32_t reserved;
+};
+
+/// The armed site. Read directly by the instrumented code.
+extern uint64_t __idc_inject_site;
+
+/// Called by the instrumented code when the armed site is reached. The
+/// original value is in the low `bits` bits of value, and the returned value
+/// replaces it.
+uint64_t __idc_inject(uint64_t site, uint64_t value, uint32_t bits);
+
+/// Arms a fault, replacing the one armed before, and resets the instance
+/// count.
+void idc_inject_arm(uint64_t site, uint64_t instance, uint32_t bit);
+
+void idc_inject_disarm(void);
+
+/// Returns 1 if the armed fault has been injected, 0 otherwise.
+int idc_inject_fired(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
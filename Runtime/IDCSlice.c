@@ -0,0 +1,184 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IDCSlice.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int check_table(const struct idc_slice_file *file, uint64_t offset,
+                       uint64_t count, uint64_t entry_size) {
+  if (offset % 8 != 0 || offset > file->size)
+    return -1;
+  if (count > (file->size - offset) / entry_size)
+    return -1;
+  return 0;
+}
+
+int idc_slice_attach(const void *data, size_t size, struct idc_slice_file *file) {
+  const struct idc_slice_header *header = (const struct idc_slice_header *)data;
+  uint32_t i, j;
+
+  memset(file, 0, sizeof(*file));
+  file->base = data;
+  file->size = size;
+
+  if (size < sizeof(*header) || memcmp(header->magic, IDC_SLICE_MAGIC, 4) != 0 ||
+      header->version != IDC_SLICE_VERSION ||
+      header->byte_order != IDC_SLICE_BYTE_ORDER)
+    return -1;
+
+  if (check_table(file, header->function_offset, header->function_count,
+                  sizeof(struct idc_slice_function)) ||
+      check_table(file, header->variable_offset, header->variable_count,
+                  sizeof(struct idc_slice_variable)) ||
+      check_table(file, header->site_offset, header->site_count,
+                  sizeof(struct idc_slice_site)) ||
+      check_table(file, header->string_offset, header->string_size, 1))
+    return -1;
+
+  file->header = header;
+  file->functions = (const struct idc_slice_function *)
+      ((const char *)data + header->function_offset);
+  file->variables = (const struct idc_slice_variable *)
+      ((const char *)data + header->variable_offset);
+  file->sites = (const struct idc_slice_site *)
+      ((const char *)data + header->site_offset);
+  file->strings = (const char *)data + header->string_offset;
+
+  // Tables index each other, so check the ranges once here and keep the
+  // lookups free of bounds checks.
+  if (header->string_size == 0 || file->strings[header->string_size - 1] != '\0')
+    return -1;
+  for (i = 0; i < header->function_count; i++) {
+    const struct idc_slice_function *function = &file->functions[i];
+    if (function->variable_begin > header->variable_count ||
+        function->variable_count > header->variable_count - function->variable_begin ||
+        function->name_offset >= header->string_size)
+      return -1;
+    // The lookups binary-search both tables.
+    if (i > 0 && function->function_id <= file->functions[i - 1].function_id)
+      return -1;
+  }
+  for (i = 0; i < header->variable_count; i++) {
+    const struct idc_slice_variable *variable = &file->variables[i];
+    if (variable->site_begin > header->site_count ||
+        variable->site_count > header->site_count - variable->site_begin ||
+        variable->name_offset >= header->string_size ||
+        variable->annotation_offset >= header->string_size)
+      return -1;
+    for (j = 1; j < variable->site_count; j++)
+      if (file->sites[variable->site_begin + j].instruction_id <=
+          file->sites[variable->site_begin + j - 1].instruction_id)
+        return -1;
+  }
+  return 0;
+}
+
+int idc_slice_open(const char *path, struct idc_slice_file *file) {
+  struct stat st;
+  void *data;
+  int fd;
+
+  memset(file, 0, sizeof(*file));
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return -1;
+  }
+
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return -1;
+
+  if (idc_slice_attach(data, (size_t)st.st_size, file) != 0) {
+    munmap(data, (size_t)st.st_size);
+    memset(file, 0, sizeof(*file));
+    return -1;
+  }
+  return 0;
+}
+
+void idc_slice_close(struct idc_slice_file *file) {
+  if (file->base)
+    munmap((void *)file->base, file->size);
+  memset(file, 0, sizeof(*file));
+}
+
+const struct idc_slice_function *
+idc_slice_find_function(const struct idc_slice_file *file, uint32_t function_id) {
+  uint32_t low = 0, high = file->header->function_count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (file->functions[mid].function_id < function_id)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low < file->header->function_count &&
+      file->functions[low].function_id == function_id)
+    return &file->functions[low];
+  return NULL;
+}
+
+const struct idc_slice_variable *
+idc_slice_get_variable(const struct idc_slice_file *file,
+                       const struct idc_slice_function *function,
+                       uint32_t index) {
+  if (index >= function->variable_count)
+    return NULL;
+  return &file->variables[function->variable_begin + index];
+}
+
+const struct idc_slice_site *
+idc_slice_find_site(const struct idc_slice_file *file,
+                    const struct idc_slice_variable *variable,
+                    uint32_t instruction_id) {
+  const struct idc_slice_site *sites = &file->sites[variable->site_begin];
+  uint32_t low = 0, high = variable->site_count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (sites[mid].instruction_id < instruction_id)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low < variable->site_count && sites[low].instruction_id == instruction_id)
+    return &sites[low];
+  return NULL;
+}
+
+uint32_t idc_slice_lookup(const struct idc_slice_file *file,
+                          uint32_t function_id, uint32_t instruction_id) {
+  const struct idc_slice_function *function =
+      idc_slice_find_function(file, function_id);
+  uint32_t flags = 0, i;
+  if (!function)
+    return 0;
+  for (i = 0; i < function->variable_count; i++) {
+    const struct idc_slice_site *site = idc_slice_find_site(
+        file, &file->variables[function->variable_begin + i], instruction_id);
+    if (site)
+      flags |= site->flags | IDC_SITE_FOUND;
+  }
+  return flags;
+}
+
+const char *idc_slice_string(const struct idc_slice_file *file, uint32_t offset) {
+  if (offset >= file->header->string_size)
+    return "";
+  return file->strings + offset;
+}
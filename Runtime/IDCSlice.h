@@ -0,0 +1,152 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  Binary slice export format and reader.
+//
+//  The file is written by the dependency pass (-idc-slice-output) and is laid
+//  out so that the fault-injection runtime can mmap it and look up sites
+//  directly. All integers are little-endian and every table is 8-byte
+//  aligned. The header holds IDC_SLICE_BYTE_ORDER so that a reader on a
+//  big-endian host rejects the file instead of misreading it.
+//
+//    idc_slice_header
+//    idc_slice_function[function_count]   sorted by function_id
+//    idc_slice_variable[variable_count]   grouped by function
+//    idc_slice_site[site_count]           grouped by variable, sorted by
+//                                         instruction_id
+//    string table                         NUL-terminated strings
+//
+//  function_id is the position of the function in its module and
+//  instruction_id is the position of the instruction in its function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDC_SLICE_H
+#define IDC_SLICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IDC_SLICE_MAGIC "IDCS"
+#define IDC_SLICE_VERSION 4
+
+/// Stored in idc_slice_header::byte_order. Reads back as 0x04030201 on a
+/// host of the other byte order.
+#define IDC_SLICE_BYTE_ORDER 0x01020304u
+
+/// The site is a Perpect dependency. Otherwise it is a Maybe dependency.
+#define IDC_SITE_PERFECT 0x1u
+
+/// The instrumenter puts a fault-injection hook on the site. Sites without
+/// it (allocas, terminators, values of other types) can never fire.
+#define IDC_SITE_INJECTABLE 0x2u
+
+/// Set by idc_slice_lookup when the instruction is in at least one slice.
+/// Never stored in the file.
+#define IDC_SITE_FOUND 0x80000000u
+
+struct idc_slice_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t function_count;
+  uint32_t variable_count;
+  uint32_t site_count;
+  uint32_t string_size;
+  uint32_t byte_order;
+  uint32_t reserved;
+  uint64_t function_offset;
+  uint64_t variable_offset;
+  uint64_t site_offset;
+  uint64_t string_offset;
+};
+
+struct idc_slice_function {
+  uint32_t function_id;
+  uint32_t name_offset;
+  uint32_t variable_begin;
+  uint32_t variable_count;
+};
+
+struct idc_slice_variable {
+  uint32_t function_id;
+  uint32_t name_offset;
+  uint32_t annotation_offset;
+  uint32_t site_begin;
+  uint32_t site_count;
+  uint32_t reserved;
+};
+
+/// Sites whose faults have the same effect form an equivalence class, and
+/// one site of the class represents it. A campaign only needs to inject into
+/// the representatives, counting each result weight times.
+struct idc_slice_site {
+  uint32_t instruction_id;
+  uint32_t flags;
+  /// instruction_id of the representative of the class of this site.
+  uint32_t representative;
+  /// Size of the class if this site is its representative, 0 otherwise.
+  uint32_t weight;
+};
+
+struct idc_slice_file {
+  const void *base;
+  size_t size;
+  const struct idc_slice_header *header;
+  const struct idc_slice_function *functions;
+  const struct idc_slice_variable *variables;
+  const struct idc_slice_site *sites;
+  const char *strings;
+};
+
+/// Maps and validates a slice file. Returns 0 on success and -1 on failure.
+/// Besides the bounds of every table, validation checks that the functions
+/// are sorted by strictly increasing function_id and the sites of each
+/// variable by strictly increasing instruction_id, as the lookups
+/// binary-search them.
+int idc_slice_open(const char *path, struct idc_slice_file *file);
+
+/// Validates a slice image that is already in memory. The image must stay
+/// alive while the file is used. Returns 0 on success and -1 on failure.
+int idc_slice_attach(const void *data, size_t size, struct idc_slice_file *file);
+
+/// Unmaps a file opened with idc_slice_open.
+void idc_slice_close(struct idc_slice_file *file);
+
+const struct idc_slice_function *
+idc_slice_find_function(const struct idc_slice_file *file, uint32_t function_id);
+
+const struct idc_slice_variable *
+idc_slice_get_variable(const struct idc_slice_file *file,
+                       const struct idc_slice_function *function,
+                       uint32_t index);
+
+/// Finds instruction_id in the slice of one variable, or returns NULL.
+const struct idc_slice_site *
+idc_slice_find_site(const struct idc_slice_file *file,
+                    const struct idc_slice_variable *variable,
+                    uint32_t instruction_id);
+
+/// Returns the combined flags of instruction_id over all variables of the
+/// function with IDC_SITE_FOUND set, or 0 if the instruction is in no slice.
+/// IDC_SITE_PERFECT is set if any slice holds it as a Perpect dependency.
+uint32_t idc_slice_lookup(const struct idc_slice_file *file,
+                          uint32_t function_id, uint32_t instruction_id);
+
+const char *idc_slice_string(const struct idc_slice_file *file, uint32_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
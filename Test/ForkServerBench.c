@@ -0,0 +1,180 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  idc-forkserver-bench: compares the run rate of the fork server with that
+//  of a fork+exec per fault.
+//
+//    idc-forkserver-bench <slice file> <program> [runs]
+//
+//  The first Perpect site of the slice that the instrumenter hooks is used.
+//  Both modes inject the same faults (instance 1, bits 0..31 in turn) and
+//  the program's output is discarded. The program should do its expensive
+//  work before it reaches the site, as Test/ForkServerTarget.c does.
+//
+//===----------------------------------------------------------------------===//
+
+#define _GNU_SOURCE
+#include "IDCInject.h"
+#include "IDCSlice.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void discard_output(void) {
+  int fd = open("/dev/null", O_WRONLY);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+}
+
+static int read_word(int fd, uint32_t *word) {
+  return read(fd, word, sizeof(*word)) == (ssize_t)sizeof(*word);
+}
+
+/// Returns the id of the first hooked Perpect representative, or
+/// IDC_INJECT_DISABLED if the slice has none.
+static uint64_t first_site(const struct idc_slice_file *file) {
+  uint32_t i, j;
+  for (i = 0; i < file->header->variable_count; i++) {
+    const struct idc_slice_variable *variable = &file->variables[i];
+    for (j = 0; j < variable->site_count; j++) {
+      const struct idc_slice_site *site = &file->sites[variable->site_begin + j];
+      if ((site->flags & IDC_SITE_PERFECT) && (site->flags & IDC_SITE_INJECTABLE) &&
+          site->weight)
+        return IDC_INJECT_SITE_ID(variable->function_id, site->instruction_id);
+    }
+  }
+  return IDC_INJECT_DISABLED;
+}
+
+/// Runs the program once per fault with fork+exec. Returns the elapsed time.
+static double run_exec(const char *program, const char *site, int runs) {
+  char bit[16];
+  double begin = now();
+  int i;
+
+  for (i = 0; i < runs; i++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      exit(1);
+    }
+    if (pid == 0) {
+      discard_output();
+      snprintf(bit, sizeof(bit), "%d", i % 32);
+      setenv("IDC_INJECT_SITE", site, 1);
+      setenv("IDC_INJECT_BIT", bit, 1);
+      execl(program, program, (char *)NULL);
+      _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+  }
+  return now() - begin;
+}
+
+/// Runs the program once as a fork server and requests every fault from it.
+/// Returns the elapsed time including the start of the server, or a
+/// negative value if the site was not reached.
+static double run_forkserver(const char *program, const char *site, int runs) {
+  int control[2], status[2], i;
+  uint32_t word;
+  double begin = now();
+  pid_t server;
+
+  if (pipe(control) || pipe(status)) {
+    perror("pipe");
+    exit(1);
+  }
+  server = fork();
+  if (server < 0) {
+    perror("fork");
+    exit(1);
+  }
+  if (server == 0) {
+    discard_output();
+    dup2(control[0], IDC_FORKSRV_FD);
+    dup2(status[1], IDC_FORKSRV_FD + 1);
+    close(control[0]);
+    close(control[1]);
+    close(status[0]);
+    close(status[1]);
+    setenv("IDC_INJECT_SITE", site, 1);
+    setenv("IDC_INJECT_FORKSERVER", "1", 1);
+    execl(program, program, (char *)NULL);
+    _exit(127);
+  }
+  close(control[0]);
+  close(status[1]);
+
+  if (!read_word(status[0], &word) || word != IDC_FORKSRV_HELLO) {
+    waitpid(server, NULL, 0);
+    return -1;
+  }
+  for (i = 0; i < runs; i++) {
+    struct idc_forksrv_request request = {1, (uint32_t)(i % 32), 0};
+    if (write(control[1], &request, sizeof(request)) != (ssize_t)sizeof(request))
+      break;
+    // pid, wait status, fired
+    if (!read_word(status[0], &word) || !read_word(status[0], &word) ||
+        !read_word(status[0], &word))
+      break;
+  }
+  close(control[1]);
+  close(status[0]);
+  waitpid(server, NULL, 0);
+  return now() - begin;
+}
+
+int main(int argc, char **argv) {
+  struct idc_slice_file file;
+  char site[32];
+  uint64_t id;
+  int runs = argc > 3 ? atoi(argv[3]) : 200;
+  double exec_time, forkserver_time;
+
+  if (argc < 3 || runs <= 0) {
+    fprintf(stderr, "usage: idc-forkserver-bench <slice file> <program> [runs]\n");
+    return 2;
+  }
+  if (idc_slice_open(argv[1], &file)) {
+    fprintf(stderr, "idc-forkserver-bench: cannot read slice file %s\n", argv[1]);
+    return 1;
+  }
+  id = first_site(&file);
+  idc_slice_close(&file);
+  if (id == IDC_INJECT_DISABLED) {
+    fprintf(stderr, "idc-forkserver-bench: no injectable Perpect site\n");
+    return 1;
+  }
+  snprintf(site, sizeof(site), "0x%" PRIx64, id);
+
+  forkserver_time = run_forkserver(argv[2], site, runs);
+  if (forkserver_time < 0) {
+    fprintf(stderr, "idc-forkserver-bench: site %s not reached\n", site);
+    return 1;
+  }
+  exec_time = run_exec(argv[2], site, runs);
+
+  printf("site %s, %d runs\n", site, runs);
+  printf("fork+exec    %8.2fs %10.1f runs/s\n", exec_time, runs / exec_time);
+  printf("fork server  %8.2fs %10.1f runs/s  (x%.1f)\n", forkserver_time,
+         runs / forkserver_time, exec_time / forkserver_time);
+  return 0;
+}
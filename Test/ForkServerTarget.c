@@ -0,0 +1,30 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  Program for idc-forkserver-bench. It is linked with the instrumented
+//  Test/a-2.ll and does a long computation before it calls foo, so that
+//  almost all of a run is spent before the injection site.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdio.h>
+
+// int foo(int) of Test/a-2.cpp
+int _Z3fooi(int);
+
+int main(void) {
+  volatile unsigned long sum = 0;
+  unsigned long i;
+
+  for (i = 0; i < 40000000UL; i++)
+    sum += i * 2654435761UL;
+  printf("%lu %d\n", (unsigned long)sum, _Z3fooi(7));
+  return 0;
+}
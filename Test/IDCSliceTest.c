@@ -0,0 +1,246 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  Round trip of the slice file format (Runtime/IDCSlice.h).
+//
+//    idc-slice-test <opt> <plugin> <Test/a.ll> <slice file>
+//
+//  Writes the slice of Test/a.ll with the dependency pass, reads it back
+//  with the IDCSlice library and checks the lookups against the slice of
+//  variable a of foo. Then checks that truncated and corrupted copies of
+//  the file are rejected.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IDCSlice.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int failures;
+
+#define CHECK(condition)                                                      \
+  do {                                                                        \
+    if (!(condition)) {                                                       \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,       \
+              #condition);                                                    \
+      failures++;                                                             \
+    }                                                                         \
+  } while (0)
+
+static int run_opt(char **argv) {
+  int status;
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    int fd = open("/dev/null", O_WRONLY);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    execv(argv[0], argv);
+    _exit(127);
+  }
+  if (waitpid(pid, &status, 0) < 0)
+    return -1;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void *read_file(const char *path, size_t *size) {
+  FILE *file = fopen(path, "rb");
+  void *data = NULL;
+  long length;
+
+  if (!file)
+    return NULL;
+  if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 &&
+      fseek(file, 0, SEEK_SET) == 0 && (data = malloc((size_t)length)) &&
+      fread(data, 1, (size_t)length, file) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *size = data ? (size_t)length : 0;
+  return data;
+}
+
+static void check_lookups(const struct idc_slice_file *file) {
+  const struct idc_slice_header *header = file->header;
+  const struct idc_slice_function *function = NULL;
+  const struct idc_slice_variable *variable;
+  uint32_t i, perfect = 0, injectable = 0;
+
+  for (i = 0; i < header->function_count; i++)
+    if (!strcmp(idc_slice_string(file, file->functions[i].name_offset), "_Z3fooi"))
+      function = &file->functions[i];
+  CHECK(function != NULL);
+  if (!function)
+    return;
+  CHECK(idc_slice_find_function(file, function->function_id) == function);
+  CHECK(idc_slice_find_function(file, function->function_id + 1000) == NULL);
+
+  CHECK(function->variable_count == 1);
+  variable = idc_slice_get_variable(file, function, 0);
+  CHECK(variable != NULL);
+  CHECK(idc_slice_get_variable(file, function, function->variable_count) == NULL);
+  if (!variable)
+    return;
+  CHECK(variable->function_id == function->function_id);
+  CHECK(!strcmp(idc_slice_string(file, variable->name_offset), "a"));
+  CHECK(!strcmp(idc_slice_string(file, variable->annotation_offset), "xxx"));
+  CHECK(!strcmp(idc_slice_string(file, header->string_size), ""));
+
+  // %a, the comparison, the two loads, the phis and the arithmetic of the
+  // loop. Only the alloca has no hook.
+  CHECK(variable->site_count == 11);
+  for (i = 0; i < variable->site_count; i++) {
+    const struct idc_slice_site *site = &file->sites[variable->site_begin + i];
+    uint32_t flags = idc_slice_lookup(file, function->function_id, site->instruction_id);
+    CHECK(i == 0 || site[-1].instruction_id < site->instruction_id);
+    CHECK(idc_slice_find_site(file, variable, site->instruction_id) == site);
+    CHECK(flags == (site->flags | IDC_SITE_FOUND));
+    CHECK(idc_slice_find_site(file, variable, site->representative) != NULL);
+    perfect += (site->flags & IDC_SITE_PERFECT) != 0;
+    injectable += (site->flags & IDC_SITE_INJECTABLE) != 0;
+  }
+  CHECK(perfect == 11);
+  CHECK(injectable == 10);
+  CHECK(!(file->sites[variable->site_begin].flags & IDC_SITE_INJECTABLE));
+  CHECK(file->sites[variable->site_begin].weight == 0);
+
+  CHECK(idc_slice_find_site(file, variable, 1000) == NULL);
+  CHECK(idc_slice_lookup(file, function->function_id, 1000) == 0);
+  CHECK(idc_slice_lookup(file, function->function_id + 1000, 0) == 0);
+}
+
+static int attach_copy(const char *data, size_t size) {
+  struct idc_slice_file file;
+  char *copy = (char *)malloc(size ? size : 1);
+  int result;
+
+  memcpy(copy, data, size);
+  result = idc_slice_attach(copy, size, &file);
+  free(copy);
+  return result;
+}
+
+static struct idc_slice_header *header_of(char *data) {
+  return (struct idc_slice_header *)data;
+}
+
+static void swap_sites(struct idc_slice_site *sites) {
+  struct idc_slice_site site = sites[0];
+  sites[0] = sites[1];
+  sites[1] = site;
+}
+
+static void check_rejected(const char *data, size_t size, const char *path) {
+  const struct idc_slice_header *header = (const struct idc_slice_header *)data;
+  struct idc_slice_file file;
+  char *copy = (char *)malloc(size);
+  size_t end = header->string_offset + header->string_size, n;
+  FILE *out;
+
+  CHECK(attach_copy(data, size) == 0);
+  for (n = 0; n < end; n++)
+    CHECK(attach_copy(data, n) != 0);
+
+  // The same through idc_slice_open.
+  out = fopen(path, "wb");
+  CHECK(out != NULL);
+  if (out) {
+    fwrite(data, 1, size / 2, out);
+    fclose(out);
+    CHECK(idc_slice_open(path, &file) != 0);
+  }
+  CHECK(idc_slice_open("/nonexistent/a.slice", &file) != 0);
+
+#define CORRUPT(statement)                                                    \
+  do {                                                                        \
+    memcpy(copy, data, size);                                                 \
+    statement;                                                                \
+    CHECK(attach_copy(copy, size) != 0);                                      \
+  } while (0)
+
+  CORRUPT(copy[0] = 'X');
+  CORRUPT(header_of(copy)->version++);
+  CORRUPT(header_of(copy)->byte_order = 0x04030201u);
+  CORRUPT(header_of(copy)->function_offset += 4);
+  CORRUPT(header_of(copy)->function_offset = size + 8);
+  CORRUPT(header_of(copy)->site_count = 0xffffffffu);
+  CORRUPT(header_of(copy)->string_size = 0);
+  CORRUPT(copy[end - 1] = 'x');
+  CORRUPT(((struct idc_slice_function *)(copy + header->function_offset))
+              ->variable_count = header->variable_count + 1);
+  CORRUPT(((struct idc_slice_function *)(copy + header->function_offset))
+              ->name_offset = header->string_size);
+  CORRUPT(((struct idc_slice_variable *)(copy + header->variable_offset))
+              ->site_begin = header->site_count + 1);
+  CORRUPT(((struct idc_slice_variable *)(copy + header->variable_offset))
+              ->site_count = header->site_count + 1);
+  CORRUPT(((struct idc_slice_variable *)(copy + header->variable_offset))
+              ->annotation_offset = header->string_size);
+
+  // Unsorted tables would make the binary searches return wrong answers.
+  if (header->function_count >= 2)
+    CORRUPT(((struct idc_slice_function *)(copy + header->function_offset))[1]
+                .function_id = ((const struct idc_slice_function *)(data +
+                                header->function_offset))[0].function_id);
+  else
+    CHECK(header->function_count >= 2);
+  CORRUPT(swap_sites((struct idc_slice_site *)(copy + header->site_offset)));
+#undef CORRUPT
+
+  free(copy);
+}
+
+int main(int argc, char **argv) {
+  struct idc_slice_file file;
+  char output[4096], corrupt_path[4096];
+  char *data;
+  size_t size;
+
+  if (argc != 5) {
+    fprintf(stderr, "usage: idc-slice-test <opt> <plugin> <a.ll> <slice file>\n");
+    return 2;
+  }
+  snprintf(output, sizeof(output), "-idc-slice-output=%s", argv[4]);
+  snprintf(corrupt_path, sizeof(corrupt_path), "%s.truncated", argv[4]);
+  {
+    char *opt[] = {argv[1], "-enable-new-pm=0", "-load", argv[2],
+                   "-dependency-module", output, argv[3], "-disable-output", NULL};
+    if (run_opt(opt)) {
+      fprintf(stderr, "idc-slice-test: %s failed\n", argv[1]);
+      return 1;
+    }
+  }
+
+  CHECK(idc_slice_open(argv[4], &file) == 0);
+  if (file.header) {
+    CHECK(file.header->version == IDC_SLICE_VERSION);
+    check_lookups(&file);
+    idc_slice_close(&file);
+  }
+
+  data = (char *)read_file(argv[4], &size);
+  CHECK(data != NULL && size >= sizeof(struct idc_slice_header));
+  if (data && size >= sizeof(struct idc_slice_header))
+    check_rejected(data, size, corrupt_path);
+  free(data);
+
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,269 @@
+//===----------------------------------------------------------------------===//
+//
+//                   Interprocedural Dependency Checker
+//
+//===----------------------------------------------------------------------===//
+//
+//  Copyright (C) 2017-2018. rollrat. All Rights Reserved.
+//
+//===----------------------------------------------------------------------===//
+//
+//  idc-pass-bench: times the dependency pass on generated modules of
+//  doubling size, to check that the pass time grows linearly.
+//
+//    idc-pass-bench <opt> <plugin> <workload> [max size]
+//
+//  Workloads:
+//
+//    branches  one function whose annotated variable is loaded, compared
+//              and stored again in each of <size> blocks chained by
+//              conditional branches (-dependency). Sizes 1000..max
+//              (default 16000).
+//
+//    calls     one function that passes its annotated variable through
+//              <size> calls to 64 small callees in turn, so that every call
+//              looks up the summary of its callee (-dependency-module).
+//              Sizes 2000..max (default 32000).
+//
+//    lookups   <size> functions whose summaries are looked up in
+//              DependencyMap about 16 million times in all, timed inside
+//              the pass (-dependency-module -idc-lookup-benchmark). Sizes
+//              1000..max (default 128000).
+//
+//  For branches and calls each size is run three times and the fastest run
+//  is reported, together with the time per unit and the ratio to the
+//  previous size. The time includes the start of opt and the parsing of the
+//  module. For lookups the rate reported by the pass is printed instead.
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *const module_header =
+    "@.str = private unnamed_addr constant [4 x i8] c\"xxx\\00\", section \"llvm.metadata\"\n"
+    "@.str.1 = private unnamed_addr constant [6 x i8] c\"a.cpp\\00\", section \"llvm.metadata\"\n"
+    "declare void @llvm.var.annotation(i8*, i8*, i8*, i32)\n\n";
+
+static const char *const annotate_a =
+    "  %a = alloca i32, align 4\n"
+    "  %a.i8 = bitcast i32* %a to i8*\n"
+    "  call void @llvm.var.annotation(i8* %a.i8, i8* getelementptr inbounds ([4 x i8], "
+    "[4 x i8]* @.str, i32 0, i32 0), i8* getelementptr inbounds ([6 x i8], "
+    "[6 x i8]* @.str.1, i32 0, i32 0), i32 1)\n";
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void write_branches(FILE *out, unsigned size) {
+  unsigned i;
+
+  fputs(module_header, out);
+  fputs("define i32 @f(i32 %n) {\nentry:\n", out);
+  fputs(annotate_a, out);
+  fputs("  store i32 %n, i32* %a, align 4\n  br label %b0\n", out);
+  for (i = 0; i < size; i++) {
+    fprintf(out, "b%u:\n", i);
+    fprintf(out, "  %%v%u = load i32, i32* %%a, align 4\n", i);
+    fprintf(out, "  %%c%u = icmp sgt i32 %%v%u, %u\n", i, i, i);
+    fprintf(out, "  %%x%u = add i32 %%v%u, 1\n", i, i);
+    fprintf(out, "  store i32 %%x%u, i32* %%a, align 4\n", i);
+    fprintf(out, "  br i1 %%c%u, label %%b%u, label %%exit\n", i, i + 1);
+  }
+  fprintf(out, "b%u:\n  br label %%exit\n", size);
+  fputs("exit:\n  %r = load i32, i32* %a, align 4\n  ret i32 %r\n}\n", out);
+}
+
+static void write_calls(FILE *out, unsigned size) {
+  const unsigned callees = 64;
+  unsigned i;
+
+  fputs(module_header, out);
+  for (i = 0; i < callees; i++)
+    fprintf(out,
+            "define i32 @g%u(i32 %%x, i32* %%p) {\n"
+            "  %%y = add i32 %%x, %u\n"
+            "  store i32 %%y, i32* %%p, align 4\n"
+            "  ret i32 %%y\n"
+            "}\n\n",
+            i, i);
+  fputs("define i32 @f(i32 %n) {\nentry:\n", out);
+  fputs(annotate_a, out);
+  fputs("  %t = alloca i32, align 4\n  store i32 %n, i32* %a, align 4\n", out);
+  fputs("  %v0 = load i32, i32* %a, align 4\n", out);
+  for (i = 0; i < size; i++)
+    fprintf(out, "  %%v%u = call i32 @g%u(i32 %%v%u, i32* %%t)\n", i + 1,
+            i % callees, i);
+  fprintf(out, "  store i32 %%v%u, i32* %%a, align 4\n  ret i32 %%v%u\n}\n", size,
+          size);
+}
+
+static void write_functions(FILE *out, unsigned size) {
+  unsigned i;
+
+  for (i = 0; i < size; i++)
+    fprintf(out, "define i32 @g%u(i32 %%x) {\n  ret i32 %%x\n}\n\n", i);
+}
+
+/// Runs opt on the module and returns the elapsed time, or a negative value
+/// if opt failed. If output is not NULL, the beginning of the standard error
+/// of opt is stored there as a string, otherwise it is discarded.
+static double run_opt(char **argv, char *output, size_t output_size) {
+  int status, pipe_fds[2] = {-1, -1};
+  size_t length = 0;
+  ssize_t n;
+  double begin = now();
+  pid_t pid;
+
+  if (output && pipe(pipe_fds))
+    return -1;
+  pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    int fd = open("/dev/null", O_WRONLY);
+    dup2(fd, STDOUT_FILENO);
+    dup2(output ? pipe_fds[1] : fd, STDERR_FILENO);
+    execv(argv[0], argv);
+    _exit(127);
+  }
+  if (output) {
+    char discard[4096];
+    close(pipe_fds[1]);
+    // Keep reading once the buffer is full so that opt never blocks.
+    for (;;) {
+      if (length + 1 < output_size)
+        n = read(pipe_fds[0], output + length, output_size - length - 1);
+      else
+        n = read(pipe_fds[0], discard, sizeof(discard));
+      if (n <= 0)
+        break;
+      if (length + 1 < output_size)
+        length += (size_t)n;
+    }
+    output[length] = '\0';
+    close(pipe_fds[0]);
+  }
+  if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+    return -1;
+  return now() - begin;
+}
+
+/// Runs the lookups workload on one module and prints the rate the pass
+/// reports. Returns 0 on success.
+static int run_lookups(const char *opt_path, const char *plugin, const char *path,
+                       unsigned size) {
+  char rounds[64], output[4096];
+  char *line, *end;
+  char *opt[] = {(char *)opt_path, "-enable-new-pm=0", "-load", (char *)plugin,
+                 "-dependency-module", rounds, (char *)path, "-disable-output", NULL};
+
+  snprintf(rounds, sizeof(rounds), "-idc-lookup-benchmark=%u",
+           size < 16000000u ? 16000000u / size : 1);
+  if (run_opt(opt, output, sizeof(output)) < 0 ||
+      !(line = strstr(output, "idc-lookup-benchmark: ")))
+    return -1;
+  if ((end = strchr(line, '\n')))
+    *end = '\0';
+  printf("%s\n", line + strlen("idc-lookup-benchmark: "));
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  char path[] = "/tmp/idc-pass-bench-XXXXXX";
+  const char *pass, *unit;
+  void (*write_module)(FILE *, unsigned);
+  unsigned size, first, max;
+  double previous = 0;
+  int fd;
+
+  if (argc < 4) {
+    fprintf(stderr, "usage: idc-pass-bench <opt> <plugin> <workload> [max size]\n");
+    return 2;
+  }
+  if (!strcmp(argv[3], "branches")) {
+    write_module = write_branches;
+    pass = "-dependency";
+    unit = "block";
+    first = 1000;
+    max = 16000;
+  } else if (!strcmp(argv[3], "calls")) {
+    write_module = write_calls;
+    pass = "-dependency-module";
+    unit = "call";
+    first = 2000;
+    max = 32000;
+  } else if (!strcmp(argv[3], "lookups")) {
+    write_module = write_functions;
+    pass = "-dependency-module";
+    unit = "function";
+    first = 1000;
+    max = 128000;
+  } else {
+    fprintf(stderr, "idc-pass-bench: unknown workload %s\n", argv[3]);
+    return 2;
+  }
+  if (argc > 4)
+    max = (unsigned)atoi(argv[4]);
+
+  fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+
+  if (write_module != write_functions)
+    printf("%8ss %10s %12s %8s\n", unit, "seconds", "us/unit", "ratio");
+  for (size = first; size <= max; size *= 2) {
+    char *opt[] = {argv[1], "-enable-new-pm=0", "-load", argv[2], (char *)pass,
+                   path, "-disable-output", NULL};
+    double best = -1;
+    int run;
+    FILE *out = fopen(path, "w");
+
+    if (!out) {
+      perror(path);
+      break;
+    }
+    write_module(out, size);
+    fclose(out);
+
+    if (write_module == write_functions) {
+      if (run_lookups(argv[1], argv[2], path, size)) {
+        fprintf(stderr, "idc-pass-bench: %s failed\n", argv[1]);
+        unlink(path);
+        return 1;
+      }
+      fflush(stdout);
+      continue;
+    }
+
+    for (run = 0; run < 3; run++) {
+      double elapsed = run_opt(opt, NULL, 0);
+      if (elapsed < 0) {
+        fprintf(stderr, "idc-pass-bench: %s failed\n", argv[1]);
+        unlink(path);
+        return 1;
+      }
+      if (best < 0 || elapsed < best)
+        best = elapsed;
+    }
+    printf("%9u %10.3f %12.2f", size, best, best / size * 1e6);
+    if (previous > 0)
+      printf(" %8.2f", best / previous);
+    printf("\n");
+    fflush(stdout);
+    previous = best;
+  }
+  unlink(path);
+  return 0;
+}